@@ -16,5 +16,6 @@ let package = Package(
   targets: [
     .target(name: "Flic2", dependencies: ["Flic2XCFramework"]),
     .binaryTarget(name: "Flic2XCFramework", path: "flic2lib.xcframework"),
+    .testTarget(name: "Flic2Tests", dependencies: ["Flic2"]),
   ]
 )
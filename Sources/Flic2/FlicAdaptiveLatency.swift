@@ -0,0 +1,272 @@
+import Foundation
+#if canImport(flic2lib)
+import flic2lib
+#endif
+
+/// The latency mode chosen by `FlicLatencyPolicy`. Mirrors `FLICLatencyMode`, so that the policy and the simulation can be
+/// used without flic2lib.
+public enum FlicLatencyLevel: Equatable {
+  case normal
+  case low
+}
+
+/// How long `FlicLatencyPolicy` keeps a button in low latency mode after a press. All durations are in seconds.
+public struct FlicLatencyDecay: Equatable {
+  /// How long low latency mode is kept after an isolated press.
+  public var window: TimeInterval
+  /// Every press that arrives while low latency mode is still active multiplies the window by this factor, so that
+  /// sustained use such as a dimmer sequence keeps the mode longer than a single double click.
+  public var growth: Double
+  /// The longest the window can grow to.
+  public var maxWindow: TimeInterval
+
+  public init(window: TimeInterval = 2, growth: Double = 2, maxWindow: TimeInterval = 30) {
+    self.window = max(0, window)
+    self.growth = max(1, growth)
+    self.maxWindow = max(self.window, maxWindow)
+  }
+
+  public static let `default` = FlicLatencyDecay()
+}
+
+/// Decides when a button should be in low latency mode.
+///
+/// A press switches to `.low`, expecting follow-up presses such as the second half of a double click. Once no press has
+/// arrived for the current window, the policy relaxes to `.normal` and the window starts over from `decay.window`. Like
+/// `FlicGestureRecognizer`, the policy is a pure state machine: feed it timestamped presses and call `advance(to:)` no later
+/// than `nextDeadline`. `FlicLatencyController` does this for you.
+public final class FlicLatencyPolicy {
+  public var decay: FlicLatencyDecay
+  public private(set) var level: FlicLatencyLevel = .normal
+  private var window: TimeInterval = 0
+  private var lowUntil: TimeInterval?
+
+  public init(decay: FlicLatencyDecay = .default) {
+    self.decay = decay
+  }
+
+  /// The time at which the policy relaxes to `.normal` unless another press arrives first.
+  public var nextDeadline: TimeInterval? {
+    return lowUntil
+  }
+
+  /// Returns the new level if the press changed it.
+  @discardableResult
+  public func press(at time: TimeInterval) -> FlicLatencyLevel? {
+    let previous = level
+    advance(to: time)
+    window = level == .low ? min(decay.maxWindow, window * decay.growth) : decay.window
+    level = .low
+    lowUntil = time + window
+    return level == previous ? nil : level
+  }
+
+  /// Relaxes to `.normal` if the window has expired at `time`. Returns the new level if it changed.
+  @discardableResult
+  public func advance(to time: TimeInterval) -> FlicLatencyLevel? {
+    guard let deadline = lowUntil, time >= deadline else { return nil }
+    return reset()
+  }
+
+  /// Relaxes to `.normal` immediately. Returns the new level if it changed.
+  @discardableResult
+  public func reset() -> FlicLatencyLevel? {
+    let previous = level
+    level = .normal
+    lowUntil = nil
+    window = 0
+    return level == previous ? nil : level
+  }
+}
+
+/// Runs one `FlicLatencyPolicy` per button and calls the handler whenever a button's latency mode should change. With
+/// flic2lib available, `init(decay:)` creates a controller that sets `FLICButton.latencyMode` itself.
+///
+/// Threading follows `FlicGestureEngine`: everything happens on `queue`. Queued presses are replays from while the
+/// button was disconnected, so they do not count as activity.
+public final class FlicLatencyController {
+  public typealias Handler = (UUID, FlicLatencyLevel) -> Void
+
+  public let queue: DispatchQueue
+  public var decay: FlicLatencyDecay {
+    didSet { policies.machines.values.forEach { $0.decay = decay } }
+  }
+
+  private let handler: Handler
+  private let clock: () -> TimeInterval
+  private let policies: FlicDeadlineTimers<FlicLatencyPolicy>
+
+  public init(queue: DispatchQueue = .main,
+              decay: FlicLatencyDecay = .default,
+              clock: @escaping () -> TimeInterval = { ProcessInfo.processInfo.systemUptime },
+              handler: @escaping Handler) {
+    self.queue = queue
+    self.decay = decay
+    self.clock = clock
+    self.handler = handler
+    // Relaxing a little late only costs energy, so the timers get a generous leeway.
+    policies = FlicDeadlineTimers(queue: queue, flags: [], leeway: .milliseconds(100), clock: clock)
+    policies.onDeadline = { [weak self] identifier, policy in
+      guard let self = self else { return }
+      self.deliver(policy.advance(to: self.clock()), for: identifier)
+    }
+  }
+
+  /// The level the controller last chose for a button.
+  public func level(for identifier: UUID) -> FlicLatencyLevel {
+    dispatchPrecondition(condition: .onQueue(queue))
+    return policies[identifier]?.level ?? .normal
+  }
+
+  public func buttonDown(_ identifier: UUID, queued: Bool) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    guard !queued else { return }
+    let policy = policies.machine(for: identifier) { FlicLatencyPolicy(decay: decay) }
+    deliver(policy.press(at: clock()), for: identifier)
+    policies.schedule(identifier)
+  }
+
+  /// Returns a button to normal latency, for example when the app moves to the background.
+  public func reset(_ identifier: UUID) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    deliver(policies[identifier]?.reset(), for: identifier)
+    policies.schedule(identifier)
+  }
+
+  /// Releases all state kept for a button. A button in low latency mode is returned to normal first.
+  public func forget(_ identifier: UUID) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    deliver(policies.removeValue(forKey: identifier)?.reset(), for: identifier)
+  }
+
+  private func deliver(_ level: FlicLatencyLevel?, for identifier: UUID) {
+    if let level = level {
+      handler(identifier, level)
+    }
+  }
+}
+
+/// Replays a recorded usage trace through `FlicLatencyPolicy` to estimate what adaptive latency costs and gains.
+public struct FlicLatencySimulation {
+  /// Expected click latency in each mode and the radio cost of low latency mode. All durations are in seconds.
+  public struct Model: Equatable {
+    /// Expected latency of a press that arrives in normal mode. The default is half the 105 ms bound documented for
+    /// `FLICLatencyModeNormal`, since a press lands at a uniformly random point of the connection interval.
+    public var normalLatency: TimeInterval
+    /// Expected latency of a press that arrives in low latency mode. The default is half the 30 ms bound documented for
+    /// `FLICLatencyModeLow`.
+    public var lowLatency: TimeInterval
+    /// Radio duty cycle of low latency mode relative to normal mode. Connection events per second are proportional to the
+    /// inverse of the connection interval, so the default is the ratio of the two latency bounds.
+    public var lowDutyCycle: Double
+    /// How long after a press low latency mode takes effect. Setting `latencyMode` starts a connection parameter update,
+    /// which is only applied several connection events later at the normal interval. The default assumes six events at
+    /// the 105 ms bound.
+    public var switchDelay: TimeInterval
+
+    public init(normalLatency: TimeInterval = 0.0525,
+                lowLatency: TimeInterval = 0.015,
+                lowDutyCycle: Double = 105.0 / 30.0,
+                switchDelay: TimeInterval = 0.63) {
+      self.normalLatency = normalLatency
+      self.lowLatency = lowLatency
+      self.lowDutyCycle = lowDutyCycle
+      self.switchDelay = max(0, switchDelay)
+    }
+
+    public static let `default` = Model()
+  }
+
+  public struct Report: Equatable {
+    public let presses: Int
+    /// Presses that arrived once low latency mode had taken effect.
+    public let lowLatencyPresses: Int
+    /// Mean expected press latency. Always `model.normalLatency` without adaptation and `model.lowLatency` with
+    /// `FLICLatencyModeLow` throughout.
+    public let meanLatency: TimeInterval
+    /// Share of the trace spent with low latency mode in effect.
+    public let lowFraction: Double
+    /// Estimated radio duty cycle relative to staying in normal mode. 1 means no extra cost, and `model.lowDutyCycle` is
+    /// the cost of `FLICLatencyModeLow` throughout.
+    public let relativeDutyCycle: Double
+  }
+
+  public var decay: FlicLatencyDecay
+  public var model: Model
+
+  public init(decay: FlicLatencyDecay = .default, model: Model = .default) {
+    self.decay = decay
+    self.model = model
+  }
+
+  /// Simulates a trace of press times, in seconds from the start of the recording, that lasted `duration` seconds. The
+  /// duration is extended to the last press if needed. Low latency mode only takes effect `model.switchDelay` after the
+  /// press that requested it. Presses before that, including the requesting press itself, have normal latency, and the
+  /// higher duty cycle is only counted from that point. Switching back to normal is treated as immediate.
+  public func run(presses: [TimeInterval], duration: TimeInterval) -> Report {
+    let policy = FlicLatencyPolicy(decay: decay)
+    let times = presses.sorted()
+    let end = max(duration, times.last ?? 0)
+    var lowTime: TimeInterval = 0
+    var lowSince: TimeInterval?
+    var lowLatencyPresses = 0
+
+    for time in times {
+      if let deadline = policy.nextDeadline, deadline <= time, let since = lowSince {
+        policy.advance(to: deadline)
+        lowTime += max(0, deadline - (since + model.switchDelay))
+        lowSince = nil
+      }
+      if let since = lowSince, time >= since + model.switchDelay {
+        lowLatencyPresses += 1
+      }
+      if policy.press(at: time) == .low {
+        lowSince = time
+      }
+    }
+    if let since = lowSince, let deadline = policy.nextDeadline {
+      lowTime += max(0, min(deadline, end) - (since + model.switchDelay))
+    }
+
+    let count = times.count
+    let meanLatency = count == 0 ? model.normalLatency
+      : (Double(lowLatencyPresses) * model.lowLatency + Double(count - lowLatencyPresses) * model.normalLatency) / Double(count)
+    let lowFraction = end > 0 ? lowTime / end : 0
+    return Report(presses: count,
+                  lowLatencyPresses: lowLatencyPresses,
+                  meanLatency: meanLatency,
+                  lowFraction: lowFraction,
+                  relativeDutyCycle: 1 + lowFraction * (model.lowDutyCycle - 1))
+  }
+}
+
+#if canImport(flic2lib)
+extension FlicLatencyLevel {
+  public var latencyMode: FLICLatencyMode {
+    switch self {
+    case .normal: return .normal
+    case .low: return .low
+    }
+  }
+}
+
+extension FlicLatencyController {
+  /// A controller that applies each change to the button's `latencyMode`. Buttons are looked up in `FLICManager`, so it
+  /// must be used on the main queue.
+  public convenience init(decay: FlicLatencyDecay = .default) {
+    self.init(queue: .main, decay: decay) { identifier, level in
+      FLICManager.shared()?.buttons().first { $0.identifier == identifier }?.latencyMode = level.latencyMode
+    }
+  }
+
+  /// Call from `button:didReceiveButtonDown:age:`.
+  public func buttonDown(_ button: FLICButton, queued: Bool) {
+    buttonDown(button.identifier, queued: queued)
+  }
+
+  /// Call when the button disconnects or is removed.
+  public func forget(_ button: FLICButton) {
+    forget(button.identifier)
+  }
+}
+#endif
@@ -0,0 +1,99 @@
+import Foundation
+
+/// A value representation of the `FLICButtonDelegate` callbacks, so that they can be queued, filtered and fanned out.
+public enum FlicButtonEvent {
+  case didConnect
+  case isReady
+  case didDisconnect(error: Error?)
+  case didFailToConnect(error: Error?)
+  case buttonDown(queued: Bool, age: Int)
+  case buttonUp(queued: Bool, age: Int)
+  case click(queued: Bool, age: Int)
+  case doubleClick(queued: Bool, age: Int)
+  case hold(queued: Bool, age: Int)
+  case didUnpair(error: Error?)
+  case batteryVoltage(Float)
+  case nickname(String)
+
+  /// The payload-free type of an event.
+  public enum Kind: Int, CaseIterable {
+    case didConnect
+    case isReady
+    case didDisconnect
+    case didFailToConnect
+    case buttonDown
+    case buttonUp
+    case click
+    case doubleClick
+    case hold
+    case didUnpair
+    case batteryVoltage
+    case nickname
+  }
+
+  public var kind: Kind {
+    switch self {
+    case .didConnect: return .didConnect
+    case .isReady: return .isReady
+    case .didDisconnect: return .didDisconnect
+    case .didFailToConnect: return .didFailToConnect
+    case .buttonDown: return .buttonDown
+    case .buttonUp: return .buttonUp
+    case .click: return .click
+    case .doubleClick: return .doubleClick
+    case .hold: return .hold
+    case .didUnpair: return .didUnpair
+    case .batteryVoltage: return .batteryVoltage
+    case .nickname: return .nickname
+    }
+  }
+}
+
+extension FlicButtonEvent.Kind {
+  /// Down, up, click, double click and hold.
+  public var isPress: Bool {
+    switch self {
+    case .buttonDown, .buttonUp, .click, .doubleClick, .hold:
+      return true
+    default:
+      return false
+    }
+  }
+
+  /// Battery and nickname updates, where only the latest value matters.
+  public var isState: Bool {
+    return self == .batteryVoltage || self == .nickname
+  }
+}
+
+extension FlicButtonEvent: FlicCallbackQueueElement {
+  public var isPress: Bool {
+    return kind.isPress
+  }
+
+  public var coalescingKey: FlicButtonEvent.Kind? {
+    return kind.isState ? kind : nil
+  }
+}
+
+/// A set of `FlicButtonEvent.Kind` values.
+public struct FlicEventMask: OptionSet {
+  public let rawValue: UInt32
+
+  public init(rawValue: UInt32) {
+    self.rawValue = rawValue
+  }
+
+  public init(_ kind: FlicButtonEvent.Kind) {
+    self.rawValue = 1 << UInt32(kind.rawValue)
+  }
+
+  public func contains(_ kind: FlicButtonEvent.Kind) -> Bool {
+    return contains(FlicEventMask(kind))
+  }
+
+  public static let connection: FlicEventMask = [FlicEventMask(.didConnect), FlicEventMask(.isReady), FlicEventMask(.didDisconnect), FlicEventMask(.didFailToConnect), FlicEventMask(.didUnpair)]
+  public static let presses: FlicEventMask = [FlicEventMask(.buttonDown), FlicEventMask(.buttonUp), FlicEventMask(.click), FlicEventMask(.doubleClick), FlicEventMask(.hold)]
+  public static let state: FlicEventMask = [FlicEventMask(.batteryVoltage), FlicEventMask(.nickname)]
+  public static let all: FlicEventMask = [.connection, .presses, .state]
+}
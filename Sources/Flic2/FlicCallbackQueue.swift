@@ -0,0 +1,148 @@
+import Foundation
+
+/// Elements that can be buffered by a `FlicCallbackQueue`.
+public protocol FlicCallbackQueueElement {
+  associatedtype CoalescingKey: Hashable
+
+  /// Presses are never dropped under `FlicOverflowPolicy.preservePresses`.
+  var isPress: Bool { get }
+  /// Under the coalescing policies, a queued element with the same non-nil key is replaced instead of growing the queue.
+  var coalescingKey: CoalescingKey? { get }
+}
+
+/// What `FlicCallbackQueue` does when an element arrives while it is full.
+public enum FlicOverflowPolicy {
+  /// The producer waits until the consumer has made room. Never use this when producing on the target queue.
+  case block
+  /// The oldest queued element is dropped.
+  case dropOldest
+  /// Elements with a coalescing key replace their queued counterpart. Otherwise the oldest element is dropped.
+  case coalesce
+  /// Like `coalesce`, but presses are never dropped. The oldest non-press element makes room. If the queue holds only
+  /// presses, a new non-press element is discarded and a new press is admitted above capacity.
+  case preservePresses
+
+  var coalesces: Bool {
+    return self == .coalesce || self == .preservePresses
+  }
+}
+
+/// A bounded FIFO that delivers elements on a target queue and applies an overflow policy when the consumer falls behind.
+///
+/// Enqueueing is thread safe. A burst of elements costs a single hop to the target queue, where they are delivered in order
+/// until the queue is empty.
+public final class FlicCallbackQueue<Element: FlicCallbackQueueElement> {
+  public let capacity: Int
+  public let policy: FlicOverflowPolicy
+  public let targetQueue: DispatchQueue
+
+  private let handler: (Element) -> Void
+  private let condition = NSCondition()
+  private var pending: [Element] = []
+  private var isDraining = false
+  private var dropped = 0
+  private var coalesced = 0
+  private var highWaterMark = 0
+
+  public init(capacity: Int = 64, policy: FlicOverflowPolicy = .preservePresses, targetQueue: DispatchQueue = .main, handler: @escaping (Element) -> Void) {
+    self.capacity = max(1, capacity)
+    self.policy = policy
+    self.targetQueue = targetQueue
+    self.handler = handler
+    pending.reserveCapacity(self.capacity)
+  }
+
+  /// The number of elements waiting to be delivered.
+  public var depth: Int {
+    condition.lock()
+    defer { condition.unlock() }
+    return pending.count
+  }
+
+  /// The largest depth observed so far.
+  public var maxDepth: Int {
+    condition.lock()
+    defer { condition.unlock() }
+    return highWaterMark
+  }
+
+  /// The number of elements discarded because the queue was full.
+  public var droppedCount: Int {
+    condition.lock()
+    defer { condition.unlock() }
+    return dropped
+  }
+
+  /// The number of elements that replaced a queued element with the same coalescing key.
+  public var coalescedCount: Int {
+    condition.lock()
+    defer { condition.unlock() }
+    return coalesced
+  }
+
+  public func enqueue(_ element: Element) {
+    if policy == .block {
+      dispatchPrecondition(condition: .notOnQueue(targetQueue))
+    }
+    condition.lock()
+    if policy.coalesces, let key = element.coalescingKey,
+       let index = pending.firstIndex(where: { $0.coalescingKey == key }) {
+      pending[index] = element
+      coalesced += 1
+      condition.unlock()
+      return
+    }
+    guard makeRoom(for: element) else {
+      condition.unlock()
+      return
+    }
+    pending.append(element)
+    highWaterMark = max(highWaterMark, pending.count)
+    let needsDrain = !isDraining
+    isDraining = true
+    condition.unlock()
+
+    if needsDrain {
+      targetQueue.async { self.drain() }
+    }
+  }
+
+  /// Returns false if the element itself should be dropped. Must be called with the lock held.
+  private func makeRoom(for element: Element) -> Bool {
+    while pending.count >= capacity {
+      switch policy {
+      case .block:
+        condition.wait()
+      case .dropOldest, .coalesce:
+        pending.removeFirst()
+        dropped += 1
+      case .preservePresses:
+        if let index = pending.firstIndex(where: { !$0.isPress }) {
+          pending.remove(at: index)
+          dropped += 1
+        } else if element.isPress {
+          return true
+        } else {
+          dropped += 1
+          return false
+        }
+      }
+    }
+    return true
+  }
+
+  private func drain() {
+    while true {
+      condition.lock()
+      if pending.isEmpty {
+        isDraining = false
+        condition.unlock()
+        return
+      }
+      let element = pending.removeFirst()
+      condition.broadcast()
+      condition.unlock()
+      handler(element)
+    }
+  }
+}
@@ -0,0 +1,88 @@
+import Foundation
+
+/// A clock-free state machine that has to be advanced when `nextDeadline` is reached.
+protocol FlicDeadlineDriven: AnyObject {
+  var nextDeadline: TimeInterval? { get }
+}
+
+extension FlicGestureRecognizer: FlicDeadlineDriven {}
+extension FlicLatencyPolicy: FlicDeadlineDriven {}
+
+/// Keeps one state machine per button, together with a timer that calls `onDeadline` once the machine's deadline is
+/// reached. Backs `FlicGestureEngine` and `FlicLatencyController`.
+///
+/// All methods must be called on `queue`, which is also where the timers fire. Call `schedule(_:)` after every change to a
+/// machine. The machine is rescheduled automatically after `onDeadline` returns.
+final class FlicDeadlineTimers<Machine: FlicDeadlineDriven> {
+  let queue: DispatchQueue
+  var onDeadline: ((UUID, Machine) -> Void)?
+  private(set) var machines: [UUID: Machine] = [:]
+
+  private let flags: DispatchSource.TimerFlags
+  private let leeway: DispatchTimeInterval
+  private let clock: () -> TimeInterval
+  private var timers: [UUID: DispatchSourceTimer] = [:]
+
+  init(queue: DispatchQueue, flags: DispatchSource.TimerFlags, leeway: DispatchTimeInterval, clock: @escaping () -> TimeInterval) {
+    self.queue = queue
+    self.flags = flags
+    self.leeway = leeway
+    self.clock = clock
+  }
+
+  deinit {
+    timers.values.forEach { $0.cancel() }
+  }
+
+  subscript(identifier: UUID) -> Machine? {
+    return machines[identifier]
+  }
+
+  func machine(for identifier: UUID, makingIfNeeded make: () -> Machine) -> Machine {
+    if let machine = machines[identifier] {
+      return machine
+    }
+    let machine = make()
+    machines[identifier] = machine
+    return machine
+  }
+
+  /// Removes a button's machine and cancels its timer.
+  func removeValue(forKey identifier: UUID) -> Machine? {
+    timers.removeValue(forKey: identifier)?.cancel()
+    return machines.removeValue(forKey: identifier)
+  }
+
+  /// Arms the button's timer for the machine's current deadline, or disarms it if there is none.
+  func schedule(_ identifier: UUID) {
+    guard let deadline = machines[identifier]?.nextDeadline else {
+      timers[identifier]?.disarm()
+      return
+    }
+    let timer: DispatchSourceTimer
+    if let existing = timers[identifier] {
+      timer = existing
+    } else {
+      timer = DispatchSource.makeTimerSource(flags: flags, queue: queue)
+      timer.setEventHandler { [weak self] in
+        self?.fire(identifier)
+      }
+      timer.resume()
+      timers[identifier] = timer
+    }
+    timer.schedule(deadline: .now() + max(0, deadline - clock()), leeway: leeway)
+  }
+
+  private func fire(_ identifier: UUID) {
+    guard let machine = machines[identifier] else { return }
+    onDeadline?(identifier, machine)
+    schedule(identifier)
+  }
+}
+
+private extension DispatchSourceTimer {
+  /// Pushes the deadline out of reach. The source is left resumed, since cancelling a suspended source crashes.
+  func disarm() {
+    schedule(deadline: .distantFuture)
+  }
+}
@@ -0,0 +1,81 @@
+#if canImport(flic2lib)
+import Foundation
+import ObjectiveC
+import flic2lib
+
+/// Resolves once which `FLICButtonDelegate` methods a delegate implements, and calls them through cached IMPs.
+///
+/// `mask` holds the events the delegate actually handles. `FlicEventBus` uses it to drop every other event before any
+/// queue hop or allocation. Dispatching an event skips both the `respondsToSelector:` check of an optional protocol call
+/// and the message lookup. The table is built when the delegate is attached. Classes that add methods at runtime after
+/// that are not picked up.
+public final class FlicDelegateDispatchTable {
+  private typealias ButtonIMP = @convention(c) (AnyObject, Selector, FLICButton) -> Void
+  private typealias ErrorIMP = @convention(c) (AnyObject, Selector, FLICButton, NSError?) -> Void
+  private typealias PressIMP = @convention(c) (AnyObject, Selector, FLICButton, ObjCBool, Int) -> Void
+  private typealias VoltageIMP = @convention(c) (AnyObject, Selector, FLICButton, Float) -> Void
+  private typealias NicknameIMP = @convention(c) (AnyObject, Selector, FLICButton, NSString) -> Void
+
+  private static let selectors: [Selector] = FlicButtonEvent.Kind.allCases.map { (kind) -> Selector in
+    switch kind {
+    case .didConnect: return #selector(FLICButtonDelegate.buttonDidConnect(_:))
+    case .isReady: return #selector(FLICButtonDelegate.buttonIsReady(_:))
+    case .didDisconnect: return #selector(FLICButtonDelegate.button(_:didDisconnectWithError:))
+    case .didFailToConnect: return #selector(FLICButtonDelegate.button(_:didFailToConnectWithError:))
+    case .buttonDown: return #selector(FLICButtonDelegate.button(_:didReceiveButtonDown:age:))
+    case .buttonUp: return #selector(FLICButtonDelegate.button(_:didReceiveButtonUp:age:))
+    case .click: return #selector(FLICButtonDelegate.button(_:didReceiveButtonClick:age:))
+    case .doubleClick: return #selector(FLICButtonDelegate.button(_:didReceiveButtonDoubleClick:age:))
+    case .hold: return #selector(FLICButtonDelegate.button(_:didReceiveButtonHold:age:))
+    case .didUnpair: return #selector(FLICButtonDelegate.button(_:didUnpairWithError:))
+    case .batteryVoltage: return #selector(FLICButtonDelegate.button(_:didUpdateBatteryVoltage:))
+    case .nickname: return #selector(FLICButtonDelegate.button(_:didUpdateNickname:))
+    }
+  }
+
+  public let mask: FlicEventMask
+  private weak var delegate: FLICButtonDelegate?
+  private let imps: [IMP?]
+
+  public init(delegate: FLICButtonDelegate) {
+    let cls: AnyClass? = object_getClass(delegate)
+    var mask: FlicEventMask = []
+    var imps: [IMP?] = []
+    for kind in FlicButtonEvent.Kind.allCases {
+      let selector = FlicDelegateDispatchTable.selectors[kind.rawValue]
+      if delegate.responds(to: selector) {
+        mask.insert(FlicEventMask(kind))
+        imps.append(class_getMethodImplementation(cls, selector))
+      } else {
+        imps.append(nil)
+      }
+    }
+    self.delegate = delegate
+    self.mask = mask
+    self.imps = imps
+  }
+
+  /// Calls the delegate method for `event`, if the delegate implements it. Returns false if the delegate is gone.
+  @discardableResult
+  public func dispatch(_ event: FlicButtonEvent, from button: FLICButton) -> Bool {
+    guard let target = delegate else { return false }
+    let index = event.kind.rawValue
+    guard let imp = imps[index] else { return true }
+    let selector = FlicDelegateDispatchTable.selectors[index]
+    switch event {
+    case .didConnect, .isReady:
+      unsafeBitCast(imp, to: ButtonIMP.self)(target, selector, button)
+    case .didDisconnect(let error), .didFailToConnect(let error), .didUnpair(let error):
+      unsafeBitCast(imp, to: ErrorIMP.self)(target, selector, button, error.map { $0 as NSError })
+    case .buttonDown(let queued, let age), .buttonUp(let queued, let age), .click(let queued, let age),
+         .doubleClick(let queued, let age), .hold(let queued, let age):
+      unsafeBitCast(imp, to: PressIMP.self)(target, selector, button, ObjCBool(queued), age)
+    case .batteryVoltage(let voltage):
+      unsafeBitCast(imp, to: VoltageIMP.self)(target, selector, button, voltage)
+    case .nickname(let nickname):
+      unsafeBitCast(imp, to: NicknameIMP.self)(target, selector, button, nickname as NSString)
+    }
+    return true
+  }
+}
+#endif
@@ -0,0 +1,295 @@
+#if canImport(flic2lib)
+import Foundation
+import flic2lib
+
+/// An event together with the button it originated from, as delivered to `FlicEventBus` subscribers.
+public struct FlicBusEvent {
+  public let button: FLICButton
+  public let event: FlicButtonEvent
+}
+
+extension FlicBusEvent: FlicCallbackQueueElement {
+  public struct CoalescingKey: Hashable {
+    let button: ObjectIdentifier
+    let kind: FlicButtonEvent.Kind
+  }
+
+  public var isPress: Bool {
+    return event.isPress
+  }
+
+  public var coalescingKey: CoalescingKey? {
+    guard let kind = event.coalescingKey else { return nil }
+    return CoalescingKey(button: ObjectIdentifier(button), kind: kind)
+  }
+}
+
+/// The overflow policies `FlicEventBus` subscribers can choose from. These are the `FlicOverflowPolicy` cases without
+/// `.block`: the bus publishes on the main queue, and blocking there would stall flic2lib and the UI.
+public enum FlicBusOverflowPolicy {
+  case dropOldest
+  case coalesce
+  case preservePresses
+
+  var queuePolicy: FlicOverflowPolicy {
+    switch self {
+    case .dropOldest: return .dropOldest
+    case .coalesce: return .coalesce
+    case .preservePresses: return .preservePresses
+    }
+  }
+}
+
+/// Set once a subscription is cancelled. Checked before every handler call, on whichever queue the subscriber chose.
+private final class FlicCancellationFlag {
+  private let lock = NSLock()
+  private var cancelled = false
+
+  var isCancelled: Bool {
+    lock.lock()
+    defer { lock.unlock() }
+    return cancelled
+  }
+
+  func cancel() {
+    lock.lock()
+    cancelled = true
+    lock.unlock()
+  }
+}
+
+/// Keeps a `FlicEventBus` subscription alive. The subscription ends when this object is cancelled or deallocated.
+///
+/// Once `cancel()` returns, the handler is not called again, even for events that were already buffered. A handler call
+/// that started before `cancel()` on another thread may still be running.
+public final class FlicEventSubscription {
+  private weak var bus: FlicEventBus?
+  private let id: Int
+  private let flag: FlicCancellationFlag
+
+  fileprivate init(bus: FlicEventBus, id: Int, flag: FlicCancellationFlag) {
+    self.bus = bus
+    self.id = id
+    self.flag = flag
+  }
+
+  deinit {
+    cancel()
+  }
+
+  /// Whether the subscription has ended, either through `cancel()` or because its delegate went away.
+  public var isCancelled: Bool {
+    return flag.isCancelled
+  }
+
+  public func cancel() {
+    flag.cancel()
+    guard let bus = bus else { return }
+    self.bus = nil
+    let id = self.id
+    if Thread.isMainThread {
+      bus.unsubscribe(id)
+    } else {
+      DispatchQueue.main.async { bus.unsubscribe(id) }
+    }
+  }
+}
+
+/// Fans `FLICButtonDelegate` callbacks out to any number of subscribers.
+///
+/// The bus installs itself as `FLICManager.buttonDelegate` and as the delegate of every known button, so it has to be the
+/// only delegate in the app and has to be retained by it. Subscribers are either manager-wide or bound to one button. Each
+/// one has an event mask and its own bounded `FlicCallbackQueue` delivering on the queue it chose.
+///
+/// Routing tables indexed by event kind are rebuilt whenever the subscriber set changes. An event of a kind nobody listens
+/// to is dropped after a single array lookup. Subscribers share the same immutable event value, so fan-out only retains
+/// the payload and never copies it. Subscribing must happen on the main queue, where flic2lib delivers its callbacks,
+/// and cancellations are applied there too. This keeps the delivery path free of locks.
+public final class FlicEventBus: NSObject, FLICButtonDelegate {
+  fileprivate final class Subscriber {
+    let mask: FlicEventMask
+    let button: UUID?
+    let queue: FlicCallbackQueue<FlicBusEvent>
+
+    init(mask: FlicEventMask, button: UUID?, queue: FlicCallbackQueue<FlicBusEvent>) {
+      self.mask = mask
+      self.button = button
+      self.queue = queue
+    }
+  }
+
+  private typealias Routes = [[Subscriber]]
+
+  private var subscribers: [Int: Subscriber] = [:]
+  private var nextID = 0
+  private var managerRoutes: Routes = FlicEventBus.emptyRoutes
+  private var buttonRoutes: [UUID: Routes] = [:]
+
+  private static let emptyRoutes = Routes(repeating: [], count: FlicButtonEvent.Kind.allCases.count)
+
+  /// Makes the bus the button delegate of `manager` and of all buttons the manager already knows about.
+  public init(manager: FLICManager) {
+    super.init()
+    manager.buttonDelegate = self
+    for button in manager.buttons() {
+      button.delegate = self
+    }
+  }
+
+  /// Creates a bus that is not installed anywhere. Set it as `FLICManager.buttonDelegate` and as the delegate of every
+  /// button yourself.
+  public override init() {
+    super.init()
+  }
+
+  /// Subscribes to events from every button.
+  public func subscribe(_ mask: FlicEventMask = .all,
+                        queue: DispatchQueue = .main,
+                        capacity: Int = 64,
+                        policy: FlicBusOverflowPolicy = .preservePresses,
+                        handler: @escaping (FlicBusEvent) -> Void) -> FlicEventSubscription {
+    return add(mask: mask, button: nil, queue: queue, capacity: capacity, policy: policy) { busEvent in
+      handler(busEvent)
+      return true
+    }
+  }
+
+  /// Subscribes to events from a single button.
+  public func subscribe(_ mask: FlicEventMask = .all,
+                        button: FLICButton,
+                        queue: DispatchQueue = .main,
+                        capacity: Int = 64,
+                        policy: FlicBusOverflowPolicy = .preservePresses,
+                        handler: @escaping (FlicBusEvent) -> Void) -> FlicEventSubscription {
+    return add(mask: mask, button: button.identifier, queue: queue, capacity: capacity, policy: policy) { busEvent in
+      handler(busEvent)
+      return true
+    }
+  }
+
+  /// Forwards events to an existing `FLICButtonDelegate`, from every button or from `button` only.
+  ///
+  /// The delegate is held weakly. Only the events it implements are subscribed to, so the others never leave the bus. The
+  /// subscription ends by itself once the first event after the delegate's deallocation reaches `queue`.
+  public func subscribe(delegate: FLICButtonDelegate,
+                        button: FLICButton? = nil,
+                        queue: DispatchQueue = .main,
+                        capacity: Int = 64,
+                        policy: FlicBusOverflowPolicy = .preservePresses) -> FlicEventSubscription {
+    let table = FlicDelegateDispatchTable(delegate: delegate)
+    return add(mask: table.mask, button: button?.identifier, queue: queue, capacity: capacity, policy: policy) { busEvent in
+      return table.dispatch(busEvent.event, from: busEvent.button)
+    }
+  }
+
+  private func add(mask: FlicEventMask,
+                   button: UUID?,
+                   queue: DispatchQueue,
+                   capacity: Int,
+                   policy: FlicBusOverflowPolicy,
+                   handler: @escaping (FlicBusEvent) -> Bool) -> FlicEventSubscription {
+    dispatchPrecondition(condition: .onQueue(.main))
+    let flag = FlicCancellationFlag()
+    let id = nextID
+    nextID += 1
+    // A handler that returns false ends the subscription, the same way cancelling it does.
+    let deliver: (FlicBusEvent) -> Void = { [weak self] busEvent in
+      guard !flag.isCancelled, !handler(busEvent) else { return }
+      flag.cancel()
+      DispatchQueue.main.async { self?.unsubscribe(id) }
+    }
+    let callbackQueue = FlicCallbackQueue<FlicBusEvent>(capacity: capacity, policy: policy.queuePolicy, targetQueue: queue, handler: deliver)
+    subscribers[id] = Subscriber(mask: mask, button: button, queue: callbackQueue)
+    rebuildRoutes()
+    return FlicEventSubscription(bus: self, id: id, flag: flag)
+  }
+
+  fileprivate func unsubscribe(_ id: Int) {
+    dispatchPrecondition(condition: .onQueue(.main))
+    if subscribers.removeValue(forKey: id) != nil {
+      rebuildRoutes()
+    }
+  }
+
+  private func rebuildRoutes() {
+    var managerRoutes = FlicEventBus.emptyRoutes
+    var buttonRoutes: [UUID: Routes] = [:]
+    for id in subscribers.keys.sorted() {
+      let subscriber = subscribers[id]!
+      for kind in FlicButtonEvent.Kind.allCases where subscriber.mask.contains(kind) {
+        if let button = subscriber.button {
+          buttonRoutes[button, default: FlicEventBus.emptyRoutes][kind.rawValue].append(subscriber)
+        } else {
+          managerRoutes[kind.rawValue].append(subscriber)
+        }
+      }
+    }
+    self.managerRoutes = managerRoutes
+    self.buttonRoutes = buttonRoutes
+  }
+
+  private func publish(_ event: FlicButtonEvent, from button: FLICButton) {
+    let kind = event.kind.rawValue
+    let global = managerRoutes[kind]
+    let local = buttonRoutes.isEmpty ? nil : buttonRoutes[button.identifier]?[kind]
+    if global.isEmpty && (local?.isEmpty ?? true) {
+      return
+    }
+    let busEvent = FlicBusEvent(button: button, event: event)
+    for subscriber in global {
+      subscriber.queue.enqueue(busEvent)
+    }
+    local?.forEach { $0.queue.enqueue(busEvent) }
+  }
+
+  // MARK: - FLICButtonDelegate
+
+  public func buttonDidConnect(_ button: FLICButton) {
+    publish(.didConnect, from: button)
+  }
+
+  public func buttonIsReady(_ button: FLICButton) {
+    publish(.isReady, from: button)
+  }
+
+  public func button(_ button: FLICButton, didDisconnectWithError error: Error?) {
+    publish(.didDisconnect(error: error), from: button)
+  }
+
+  public func button(_ button: FLICButton, didFailToConnectWithError error: Error?) {
+    publish(.didFailToConnect(error: error), from: button)
+  }
+
+  public func button(_ button: FLICButton, didReceiveButtonDown queued: Bool, age: Int) {
+    publish(.buttonDown(queued: queued, age: age), from: button)
+  }
+
+  public func button(_ button: FLICButton, didReceiveButtonUp queued: Bool, age: Int) {
+    publish(.buttonUp(queued: queued, age: age), from: button)
+  }
+
+  public func button(_ button: FLICButton, didReceiveButtonClick queued: Bool, age: Int) {
+    publish(.click(queued: queued, age: age), from: button)
+  }
+
+  public func button(_ button: FLICButton, didReceiveButtonDoubleClick queued: Bool, age: Int) {
+    publish(.doubleClick(queued: queued, age: age), from: button)
+  }
+
+  public func button(_ button: FLICButton, didReceiveButtonHold queued: Bool, age: Int) {
+    publish(.hold(queued: queued, age: age), from: button)
+  }
+
+  public func button(_ button: FLICButton, didUnpairWithError error: Error?) {
+    publish(.didUnpair(error: error), from: button)
+  }
+
+  public func button(_ button: FLICButton, didUpdateBatteryVoltage voltage: Float) {
+    publish(.batteryVoltage(voltage), from: button)
+  }
+
+  public func button(_ button: FLICButton, didUpdateNickname nickname: String) {
+    publish(.nickname(nickname), from: button)
+  }
+}
+#endif
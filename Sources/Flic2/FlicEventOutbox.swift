@@ -0,0 +1,348 @@
+import Foundation
+#if canImport(flic2lib)
+import flic2lib
+#endif
+
+extension FlicButtonEvent.Kind: Codable {}
+
+/// A press event persisted by `FlicEventOutbox`.
+public struct FlicOutboxEvent: Codable, Equatable {
+  /// Identifies an appended event. No two events appended to the same outbox share a key, and a redelivered event keeps
+  /// its key, so consumers can use it to drop redeliveries.
+  ///
+  /// The key is derived from the public `pressCount`, which is read when the event reaches the app. That makes it a
+  /// record identity, not a physical press identity. For example, queued events replayed on reconnect all see the same
+  /// count and are told apart only by `ordinal`. `bootID` is a best-effort guess at the button's boot. A reboot is missed if
+  /// the button is pressed past the previous count before it reconnects. Uniqueness does not depend on `bootID`.
+  public struct Key: Codable, Hashable {
+    /// `FLICButton.uuid` of the originating button.
+    public let button: String
+    /// Incremented every time the button's press counter is seen going backwards, which happens when the Flic reboots.
+    public let bootID: UInt32
+    /// `FLICButton.pressCount` when the event was received.
+    public let eventCount: UInt32
+    /// Position among the events appended for this button with the same `bootID` and `eventCount`, starting at 0.
+    public let ordinal: UInt32
+  }
+
+  /// Position in the outbox. Pass it to `FlicEventOutbox.acknowledge(_:)` once the event has been handled.
+  public let sequence: UInt64
+  public let key: Key
+  public let kind: FlicButtonEvent.Kind
+  public let queued: Bool
+  public let age: Int
+  public let date: Date
+}
+
+/// An append-only, on-disk outbox that delivers press events at least once.
+///
+/// Appended events are written to the log and synced to disk before the handler sees them. The handler is called again for
+/// every unacknowledged event each time the outbox is opened, for example after the app was killed, and whenever
+/// `redeliverUnacknowledged()` is called. Appends and acknowledgements that arrive within `commitDelay` of each other share a
+/// single write and fsync. The log is rewritten with only the unacknowledged events once it holds mostly acknowledged ones.
+/// Events carry a `FlicOutboxEvent.Key` that is unique within the outbox. See its documentation for what it does not
+/// guarantee.
+public final class FlicEventOutbox {
+  private struct Record: Codable {
+    var event: FlicOutboxEvent? = nil
+    var ack: UInt64? = nil
+    var boot: Boot? = nil
+    var nextSequence: UInt64? = nil
+  }
+
+  /// The last key handed out for a button. Within one `bootID`, counts never decrease, so together with `nextOrdinal` it is
+  /// enough to keep keys unique.
+  private struct Boot: Codable {
+    let button: String
+    var bootID: UInt32
+    var lastCount: UInt32
+    var nextOrdinal: UInt32
+
+    func precedes(_ other: Boot) -> Bool {
+      return (bootID, lastCount, nextOrdinal) < (other.bootID, other.lastCount, other.nextOrdinal)
+    }
+  }
+
+  public let url: URL
+  /// How long appends are collected before they are committed together.
+  public let commitDelay: TimeInterval
+  public let deliveryQueue: DispatchQueue
+
+  private let handler: (FlicOutboxEvent) -> Void
+  private let ioQueue = DispatchQueue(label: "flic2.outbox")
+  /// Nil after compaction replaced the log but the new file could not be opened. The next commit reopens it.
+  private var file: FileHandle?
+  private let encoder = JSONEncoder()
+  private var unacknowledged: [UInt64: FlicOutboxEvent] = [:]
+  private var boots: [String: Boot] = [:]
+  private var nextSequence: UInt64 = 1
+  private var recordCount = 0
+  private var uncommitted: [Record] = []
+  private var undelivered: [FlicOutboxEvent] = []
+  private var commitScheduled = false
+
+  private static let compactionThreshold = 1024
+  private static let retryDelay: TimeInterval = 1
+
+  /// Opens or creates the outbox at `url` and schedules redelivery of every event that was not acknowledged.
+  public init(url: URL,
+              commitDelay: TimeInterval = 0.005,
+              deliveryQueue: DispatchQueue = .main,
+              handler: @escaping (FlicOutboxEvent) -> Void) throws {
+    self.url = url
+    self.commitDelay = commitDelay
+    self.deliveryQueue = deliveryQueue
+    self.handler = handler
+
+    let fileManager = FileManager.default
+    if !fileManager.fileExists(atPath: url.path) {
+      try fileManager.createDirectory(at: url.deletingLastPathComponent(), withIntermediateDirectories: true, attributes: nil)
+      guard fileManager.createFile(atPath: url.path, contents: nil, attributes: nil) else {
+        throw CocoaError(.fileWriteUnknown, userInfo: [NSFilePathErrorKey: url.path])
+      }
+    }
+    let data = try Data(contentsOf: url)
+    let handle = try FileHandle(forUpdating: url)
+    // Cuts off a torn final line, so that the next append starts on a line of its own instead of being glued to it.
+    let complete = (data.lastIndex(of: UInt8(ascii: "\n")).map { $0 + 1 } ?? data.startIndex) - data.startIndex
+    if complete < data.count {
+      guard ftruncate(handle.fileDescriptor, off_t(complete)) == 0, fsync(handle.fileDescriptor) == 0 else {
+        let error = POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO)
+        handle.closeFile()
+        throw error
+      }
+    }
+    file = handle
+    load(data.prefix(complete))
+
+    let pending = unacknowledged.values.sorted { $0.sequence < $1.sequence }
+    if !pending.isEmpty {
+      deliver(pending)
+    }
+  }
+
+  deinit {
+    file?.closeFile()
+  }
+
+  /// The number of events that have been appended but not yet acknowledged.
+  public var unacknowledgedCount: Int {
+    return ioQueue.sync { unacknowledged.count }
+  }
+
+  /// Persists a press event and delivers it once it is on disk. Safe to call from any thread.
+  public func append(kind: FlicButtonEvent.Kind, button: String, pressCount: UInt32, queued: Bool, age: Int) {
+    let date = Date()
+    ioQueue.async {
+      var boot = self.boots[button] ?? Boot(button: button, bootID: 0, lastCount: pressCount, nextOrdinal: 0)
+      if pressCount < boot.lastCount {
+        boot.bootID += 1
+        boot.nextOrdinal = 0
+      } else if pressCount > boot.lastCount {
+        boot.nextOrdinal = 0
+      }
+      boot.lastCount = pressCount
+      let key = FlicOutboxEvent.Key(button: button, bootID: boot.bootID, eventCount: pressCount, ordinal: boot.nextOrdinal)
+      boot.nextOrdinal += 1
+      self.boots[button] = boot
+
+      let event = FlicOutboxEvent(sequence: self.nextSequence, key: key, kind: kind, queued: queued, age: age, date: date)
+      self.nextSequence += 1
+      self.unacknowledged[event.sequence] = event
+      self.uncommitted.append(Record(event: event))
+      self.undelivered.append(event)
+      self.scheduleCommit()
+    }
+  }
+
+  /// Marks an event as handled so that it is never delivered again.
+  public func acknowledge(_ sequence: UInt64) {
+    ioQueue.async {
+      guard self.unacknowledged.removeValue(forKey: sequence) != nil else { return }
+      self.uncommitted.append(Record(ack: sequence))
+      self.scheduleCommit()
+    }
+  }
+
+  /// Delivers every committed, unacknowledged event again.
+  public func redeliverUnacknowledged() {
+    ioQueue.async {
+      let pending = Set(self.undelivered.map { $0.sequence })
+      let events = self.unacknowledged.values.filter { !pending.contains($0.sequence) }
+      self.deliver(events.sorted { $0.sequence < $1.sequence })
+    }
+  }
+
+  /// Blocks until everything appended or acknowledged so far is on disk.
+  public func flush() {
+    ioQueue.sync {
+      self.commit()
+    }
+  }
+
+  private func load(_ data: Data) {
+    let decoder = JSONDecoder()
+    for line in data.split(separator: UInt8(ascii: "\n")) {
+      // Undecodable lines are skipped. A torn final line has already been cut off by init, and its event was never delivered.
+      guard let record = try? decoder.decode(Record.self, from: Data(line)) else { continue }
+      recordCount += 1
+      if let event = record.event {
+        unacknowledged[event.sequence] = event
+        nextSequence = max(nextSequence, event.sequence + 1)
+        let key = event.key
+        observe(Boot(button: key.button, bootID: key.bootID, lastCount: key.eventCount, nextOrdinal: key.ordinal + 1))
+      }
+      if let sequence = record.ack {
+        unacknowledged[sequence] = nil
+      }
+      if let sequence = record.nextSequence {
+        nextSequence = max(nextSequence, sequence)
+      }
+      if let boot = record.boot {
+        observe(boot)
+      }
+    }
+  }
+
+  /// Keeps the latest boot state seen for a button while loading.
+  private func observe(_ boot: Boot) {
+    if let current = boots[boot.button], !current.precedes(boot) {
+      return
+    }
+    boots[boot.button] = boot
+  }
+
+  private func scheduleCommit(after delay: TimeInterval? = nil) {
+    guard !commitScheduled else { return }
+    commitScheduled = true
+    ioQueue.asyncAfter(deadline: .now() + (delay ?? commitDelay)) {
+      self.commit()
+    }
+  }
+
+  /// Writes and syncs everything uncommitted, then delivers the new events. If nothing could be written, the batch stays
+  /// pending and undelivered, and the commit is retried later. Must be called on `ioQueue`.
+  private func commit() {
+    commitScheduled = false
+    guard !uncommitted.isEmpty else { return }
+
+    let records = recordCount + uncommitted.count
+    let needsCompaction = records > FlicEventOutbox.compactionThreshold && unacknowledged.count * 4 < records
+    guard (needsCompaction && compact()) || appendUncommitted() else {
+      scheduleCommit(after: FlicEventOutbox.retryDelay)
+      return
+    }
+    uncommitted.removeAll()
+
+    let events = undelivered
+    undelivered.removeAll()
+    deliver(events)
+  }
+
+  /// Appends the uncommitted records to the log and syncs it. Returns false if the log could not be opened or written, in
+  /// which case it is left as it was. Must be called on `ioQueue`.
+  private func appendUncommitted() -> Bool {
+    if file == nil {
+      file = try? FileHandle(forUpdating: url)
+    }
+    guard let file = file, FlicEventOutbox.append(encode(uncommitted), to: file.fileDescriptor) else { return false }
+    recordCount += uncommitted.count
+    return true
+  }
+
+  /// Replaces the log with one that only holds boot state, unacknowledged events and the sequence counter. The new log
+  /// already reflects every uncommitted record. Returns false if the old log is still in place, in which case the caller
+  /// appends to it instead. Must be called on `ioQueue`.
+  private func compact() -> Bool {
+    var records = boots.values.map { Record(boot: $0) }
+    records += unacknowledged.values.sorted { $0.sequence < $1.sequence }.map { Record(event: $0) }
+    // Keeps sequence numbers from being reused once every event has been acknowledged.
+    records.append(Record(nextSequence: nextSequence))
+
+    let fileManager = FileManager.default
+    let temporary = url.appendingPathExtension("compacting")
+    guard fileManager.createFile(atPath: temporary.path, contents: nil, attributes: nil),
+          let handle = try? FileHandle(forWritingTo: temporary) else {
+      try? fileManager.removeItem(at: temporary)
+      return false
+    }
+    let written = FlicEventOutbox.append(encode(records), to: handle.fileDescriptor)
+    handle.closeFile()
+    guard written else {
+      try? fileManager.removeItem(at: temporary)
+      return false
+    }
+    do {
+      _ = try fileManager.replaceItemAt(url, withItemAt: temporary)
+    } catch {
+      try? fileManager.removeItem(at: temporary)
+      return false
+    }
+
+    // The old handle now points at the replaced file. It is only swapped for a handle on the new log, never reused.
+    file?.closeFile()
+    file = try? FileHandle(forUpdating: url)
+    recordCount = records.count
+    return true
+  }
+
+  /// Writes `data` at the end of the file and syncs it. If either step fails, the file is truncated back to its previous
+  /// length, so that a partial write never leaves a torn line for the next append to be glued onto. This uses the POSIX
+  /// calls directly, because the `FileHandle` methods raise Objective-C exceptions on I/O errors.
+  private static func append(_ data: Data, to descriptor: Int32) -> Bool {
+    let start = lseek(descriptor, 0, SEEK_END)
+    guard start >= 0 else { return false }
+    let written = data.withUnsafeBytes { (buffer: UnsafeRawBufferPointer) -> Bool in
+      var offset = 0
+      while offset < buffer.count {
+        let result = write(descriptor, buffer.baseAddress! + offset, buffer.count - offset)
+        if result < 0 {
+          if errno == EINTR {
+            continue
+          }
+          return false
+        }
+        offset += result
+      }
+      return true
+    }
+    guard written, fsync(descriptor) == 0 else {
+      _ = ftruncate(descriptor, start)
+      return false
+    }
+    return true
+  }
+
+  private func encode(_ records: [Record]) -> Data {
+    var data = Data()
+    for record in records {
+      if let line = try? encoder.encode(record) {
+        data.append(line)
+        data.append(UInt8(ascii: "\n"))
+      }
+    }
+    return data
+  }
+
+  private func deliver(_ events: [FlicOutboxEvent]) {
+    guard !events.isEmpty else { return }
+    let handler = self.handler
+    deliveryQueue.async {
+      events.forEach(handler)
+    }
+  }
+}
+
+#if canImport(flic2lib)
+extension FlicEventOutbox {
+  /// Persists a click, double click or hold from `button`. Other events are ignored.
+  public func append(_ event: FlicButtonEvent, from button: FLICButton) {
+    switch event {
+    case .click(let queued, let age), .doubleClick(let queued, let age), .hold(let queued, let age):
+      append(kind: event.kind, button: button.uuid, pressCount: button.pressCount, queued: queued, age: age)
+    default:
+      break
+    }
+  }
+}
+#endif
@@ -0,0 +1,269 @@
+import Foundation
+#if canImport(flic2lib)
+import flic2lib
+#endif
+
+/// A gesture decided by `FlicGestureRecognizer`.
+public enum FlicGesture: Equatable {
+  /// `count` consecutive clicks. A count of 1 is a single click, 2 a double click and so on.
+  case click(count: Int)
+  /// The button was held down for at least the configured hold duration.
+  case hold
+  /// `clicks` clicks followed by a press that was held for the configured hold duration.
+  case clickThenHold(clicks: Int)
+  /// Speculative mode only. A single click delivered on button up, before the multi click window has expired. It is
+  /// followed by either `click(count: 1)` with the same id once the click is confirmed, or `retraction`.
+  case provisionalClick
+  /// Speculative mode only. The provisional click with the same id should be rolled back. This happens when it turns into a
+  /// longer gesture, or when the recognizer is reset before the click could be confirmed.
+  case retraction
+}
+
+/// Thresholds used by `FlicGestureRecognizer`. All durations are in seconds.
+public struct FlicGestureThresholds: Equatable {
+  /// The longest gap between a button up and the next button down for both presses to belong to the same gesture.
+  public var multiClickWindow: TimeInterval
+  /// How long the button has to be held down before the press is reported as a hold.
+  public var holdDuration: TimeInterval
+  /// The highest click count that will be reported. Reaching it decides the gesture on button up, without waiting for the multi click window.
+  public var maxClickCount: Int
+
+  public init(multiClickWindow: TimeInterval = 0.3, holdDuration: TimeInterval = 0.6, maxClickCount: Int = 3) {
+    self.multiClickWindow = multiClickWindow
+    self.holdDuration = holdDuration
+    self.maxClickCount = max(1, maxClickCount)
+  }
+
+  public static let `default` = FlicGestureThresholds()
+}
+
+/// A gesture together with the times it started and became unambiguous.
+public struct FlicGestureDecision: Equatable {
+  public let gesture: FlicGesture
+  /// Identifies the gesture. A provisional click, its retraction and the final gesture share the same id.
+  public let id: UInt64
+  /// Time of the button down that started the gesture.
+  public let startTime: TimeInterval
+  /// Time at which no further input could have changed the gesture.
+  public let decisionTime: TimeInterval
+}
+
+/// Classifies raw button down and up events into clicks, n-clicks, holds and click-then-hold.
+///
+/// The recognizer is a pure state machine: it never reads a clock or schedules timers itself. Feed it timestamped
+/// events and call `advance(to:)` no later than `nextDeadline` so that pending decisions are emitted as soon as they become
+/// unambiguous. `FlicGestureEngine` does this for you.
+public final class FlicGestureRecognizer {
+  private enum State {
+    case idle
+    case pressed(id: UInt64, start: TimeInterval, downAt: TimeInterval, clicks: Int)
+    case released(id: UInt64, start: TimeInterval, upAt: TimeInterval, clicks: Int, provisional: Bool)
+    case holding
+  }
+
+  public var thresholds: FlicGestureThresholds
+  /// When enabled, a first click is delivered as `provisionalClick` on button up whenever a longer gesture is still possible.
+  public var speculative = false
+  private var state: State = .idle
+  private var nextID: UInt64 = 1
+
+  public init(thresholds: FlicGestureThresholds = .default) {
+    self.thresholds = thresholds
+  }
+
+  /// The time at which the pending gesture, if any, will be decided unless another event arrives first.
+  public var nextDeadline: TimeInterval? {
+    switch state {
+    case .pressed(_, _, let downAt, _):
+      return downAt + thresholds.holdDuration
+    case .released(_, _, let upAt, _, _):
+      return upAt + thresholds.multiClickWindow
+    case .idle, .holding:
+      return nil
+    }
+  }
+
+  public func buttonDown(at time: TimeInterval) -> [FlicGestureDecision] {
+    var decisions = advance(to: time)
+    switch state {
+    case .idle:
+      state = .pressed(id: nextID, start: time, downAt: time, clicks: 0)
+      nextID += 1
+    case .released(let id, let start, _, let clicks, let provisional):
+      if provisional {
+        decisions.append(FlicGestureDecision(gesture: .retraction, id: id, startTime: start, decisionTime: time))
+      }
+      state = .pressed(id: id, start: start, downAt: time, clicks: clicks)
+    case .pressed, .holding:
+      break
+    }
+    return decisions
+  }
+
+  public func buttonUp(at time: TimeInterval) -> [FlicGestureDecision] {
+    var decisions = advance(to: time)
+    switch state {
+    case .pressed(let id, let start, _, let clicks):
+      let count = clicks + 1
+      if count >= thresholds.maxClickCount {
+        state = .idle
+        decisions.append(FlicGestureDecision(gesture: .click(count: count), id: id, startTime: start, decisionTime: time))
+      } else {
+        let provisional = speculative && count == 1
+        if provisional {
+          decisions.append(FlicGestureDecision(gesture: .provisionalClick, id: id, startTime: start, decisionTime: time))
+        }
+        state = .released(id: id, start: start, upAt: time, clicks: count, provisional: provisional)
+      }
+    case .holding:
+      state = .idle
+    case .idle, .released:
+      break
+    }
+    return decisions
+  }
+
+  /// Emits every decision whose deadline is at or before `time`.
+  @discardableResult
+  public func advance(to time: TimeInterval) -> [FlicGestureDecision] {
+    switch state {
+    case .pressed(let id, let start, let downAt, let clicks) where time >= downAt + thresholds.holdDuration:
+      state = .holding
+      let gesture: FlicGesture = clicks == 0 ? .hold : .clickThenHold(clicks: clicks)
+      return [FlicGestureDecision(gesture: gesture, id: id, startTime: start, decisionTime: downAt + thresholds.holdDuration)]
+    case .released(let id, let start, let upAt, let clicks, _) where time >= upAt + thresholds.multiClickWindow:
+      state = .idle
+      return [FlicGestureDecision(gesture: .click(count: clicks), id: id, startTime: start, decisionTime: upAt + thresholds.multiClickWindow)]
+    default:
+      return []
+    }
+  }
+
+  /// Drops any gesture in progress. Decisions already due at `time` are emitted first. A provisional click that is still
+  /// waiting for confirmation is retracted, so every `provisionalClick` is always followed by a confirmation or a retraction.
+  @discardableResult
+  public func reset(at time: TimeInterval) -> [FlicGestureDecision] {
+    var decisions = advance(to: time)
+    if case .released(let id, let start, _, _, true) = state {
+      decisions.append(FlicGestureDecision(gesture: .retraction, id: id, startTime: start, decisionTime: time))
+    }
+    state = .idle
+    return decisions
+  }
+}
+
+/// Runs one `FlicGestureRecognizer` per button and fires its deadlines with a timer, so that decisions are delivered the
+/// moment they become unambiguous.
+///
+/// All methods must be called on `queue`, which is also where the handler is invoked. The default is the main queue, which
+/// is where flic2lib delivers `FLICButtonDelegate` callbacks. Queued events only carry an age rounded to seconds, so they
+/// reset any gesture in progress, as `reset(_:)` does, and are otherwise ignored.
+public final class FlicGestureEngine {
+  public typealias Handler = (UUID, FlicGestureDecision) -> Void
+
+  public let queue: DispatchQueue
+  /// Thresholds given to buttons that have not been configured with `setThresholds(_:for:)`.
+  public var defaultThresholds: FlicGestureThresholds
+  /// Whether first clicks are delivered provisionally. See `FlicGestureRecognizer.speculative`.
+  public var speculative = false {
+    didSet { recognizers.machines.values.forEach { $0.speculative = speculative } }
+  }
+
+  private let handler: Handler
+  private let clock: () -> TimeInterval
+  private let recognizers: FlicDeadlineTimers<FlicGestureRecognizer>
+
+  public init(queue: DispatchQueue = .main,
+              thresholds: FlicGestureThresholds = .default,
+              clock: @escaping () -> TimeInterval = { ProcessInfo.processInfo.systemUptime },
+              handler: @escaping Handler) {
+    self.queue = queue
+    self.defaultThresholds = thresholds
+    self.clock = clock
+    self.handler = handler
+    recognizers = FlicDeadlineTimers(queue: queue, flags: .strict, leeway: .milliseconds(1), clock: clock)
+    recognizers.onDeadline = { [weak self] identifier, recognizer in
+      guard let self = self else { return }
+      self.deliver(recognizer.advance(to: self.clock()), for: identifier)
+    }
+  }
+
+  public func setThresholds(_ thresholds: FlicGestureThresholds, for identifier: UUID) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    let recognizer = self.recognizer(for: identifier)
+    recognizer.thresholds = thresholds
+    deliver(recognizer.advance(to: clock()), for: identifier)
+    recognizers.schedule(identifier)
+  }
+
+  public func buttonDown(_ identifier: UUID, queued: Bool) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    let recognizer = self.recognizer(for: identifier)
+    if queued {
+      deliver(recognizer.reset(at: clock()), for: identifier)
+    } else {
+      deliver(recognizer.buttonDown(at: clock()), for: identifier)
+    }
+    recognizers.schedule(identifier)
+  }
+
+  public func buttonUp(_ identifier: UUID, queued: Bool) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    let recognizer = self.recognizer(for: identifier)
+    if queued {
+      deliver(recognizer.reset(at: clock()), for: identifier)
+    } else {
+      deliver(recognizer.buttonUp(at: clock()), for: identifier)
+    }
+    recognizers.schedule(identifier)
+  }
+
+  /// Drops the gesture in progress for a button, for example when it disconnects. A pending provisional click is retracted.
+  public func reset(_ identifier: UUID) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    if let recognizer = recognizers[identifier] {
+      deliver(recognizer.reset(at: clock()), for: identifier)
+    }
+    recognizers.schedule(identifier)
+  }
+
+  /// Releases all state kept for a button. A pending provisional click is retracted first.
+  public func forget(_ identifier: UUID) {
+    dispatchPrecondition(condition: .onQueue(queue))
+    if let recognizer = recognizers.removeValue(forKey: identifier) {
+      deliver(recognizer.reset(at: clock()), for: identifier)
+    }
+  }
+
+  private func recognizer(for identifier: UUID) -> FlicGestureRecognizer {
+    return recognizers.machine(for: identifier) {
+      let recognizer = FlicGestureRecognizer(thresholds: defaultThresholds)
+      recognizer.speculative = speculative
+      return recognizer
+    }
+  }
+
+  private func deliver(_ decisions: [FlicGestureDecision], for identifier: UUID) {
+    for decision in decisions {
+      handler(identifier, decision)
+    }
+  }
+}
+
+#if canImport(flic2lib)
+extension FlicGestureEngine {
+  /// Call from `button:didReceiveButtonDown:age:`.
+  public func buttonDown(_ button: FLICButton, queued: Bool) {
+    buttonDown(button.identifier, queued: queued)
+  }
+
+  /// Call from `button:didReceiveButtonUp:age:`.
+  public func buttonUp(_ button: FLICButton, queued: Bool) {
+    buttonUp(button.identifier, queued: queued)
+  }
+
+  public func setThresholds(_ thresholds: FlicGestureThresholds, for button: FLICButton) {
+    setThresholds(thresholds, for: button.identifier)
+  }
+}
+#endif
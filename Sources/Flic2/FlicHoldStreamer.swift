@@ -0,0 +1,130 @@
+import Foundation
+#if canImport(flic2lib)
+import flic2lib
+#endif
+
+/// An update emitted by `FlicHoldStreamer`.
+public enum FlicHoldStreamEvent: Equatable {
+  /// The button has been held down for `elapsed` seconds and is still down.
+  case tick(elapsed: TimeInterval)
+  /// The button was released after being held for `duration` seconds. Only sent for holds that emitted at least one tick.
+  case released(duration: TimeInterval)
+}
+
+/// Streams periodic "held for" updates while a button is down, for dimmer or volume style control.
+///
+/// Ticks are emitted at `rate` Hz on `queue` from a strict timer whose deadlines are computed from the time of the button
+/// down. Each tick reports the actual elapsed time, so a late tick never shifts the ones after it. flic2lib does not expose
+/// the button's own timestamps, so the button down is stamped with the phone's monotonic clock as soon as it is delivered.
+/// Queued events are ignored, since the press they belong to is already over. A press released before its first tick, such
+/// as a short click under `startDelay`, produces no events at all.
+///
+/// The button up is lost when the button disconnects while held. Call `cancel(_:)` from `button:didDisconnectWithError:`
+/// to stop the stream. As a backstop, a hold stops streaming on its own after `maxDuration`. No `released` event is sent
+/// in either case.
+public final class FlicHoldStreamer {
+  public typealias Handler = (UUID, FlicHoldStreamEvent) -> Void
+
+  public let rate: Double
+  /// How long the button must be down before the first tick. Use it to keep short clicks from starting a ramp.
+  public let startDelay: TimeInterval
+  /// The longest a hold is streamed. Ticks stop after this, so a lost button up cannot drive a ramp to its limit.
+  public let maxDuration: TimeInterval
+  public let queue: DispatchQueue
+
+  private struct Hold {
+    let downAt: TimeInterval
+    let timer: DispatchSourceTimer
+    var ticked = false
+  }
+
+  private let handler: Handler
+  private let clock: () -> TimeInterval
+  private var holds: [UUID: Hold] = [:]
+
+  public init(rate: Double = 30,
+              startDelay: TimeInterval = 0,
+              maxDuration: TimeInterval = 30,
+              queue: DispatchQueue = DispatchQueue(label: "flic2.holdstreamer", qos: .userInteractive),
+              clock: @escaping () -> TimeInterval = { ProcessInfo.processInfo.systemUptime },
+              handler: @escaping Handler) {
+    self.rate = max(1, rate)
+    self.startDelay = max(0, startDelay)
+    self.maxDuration = max(0, maxDuration)
+    self.queue = queue
+    self.clock = clock
+    self.handler = handler
+  }
+
+  deinit {
+    holds.values.forEach { $0.timer.cancel() }
+  }
+
+  public func buttonDown(_ identifier: UUID, queued: Bool) {
+    guard !queued else { return }
+    let downAt = clock()
+    queue.async {
+      self.stop(identifier)
+      let timer = DispatchSource.makeTimerSource(flags: .strict, queue: self.queue)
+      timer.setEventHandler { [weak self] in
+        guard let self = self, let hold = self.holds[identifier] else { return }
+        let elapsed = self.clock() - hold.downAt
+        guard elapsed <= self.maxDuration else {
+          self.stop(identifier)
+          return
+        }
+        self.holds[identifier]?.ticked = true
+        self.handler(identifier, .tick(elapsed: elapsed))
+      }
+      let interval = 1 / self.rate
+      let firstTick = downAt + max(self.startDelay, interval)
+      timer.schedule(deadline: .now() + max(0, firstTick - self.clock()),
+                     repeating: .nanoseconds(Int(interval * 1_000_000_000)),
+                     leeway: .nanoseconds(0))
+      self.holds[identifier] = Hold(downAt: downAt, timer: timer)
+      timer.resume()
+    }
+  }
+
+  public func buttonUp(_ identifier: UUID, queued: Bool) {
+    guard !queued else { return }
+    let upAt = clock()
+    queue.async {
+      guard let hold = self.stop(identifier), hold.ticked else { return }
+      self.handler(identifier, .released(duration: upAt - hold.downAt))
+    }
+  }
+
+  /// Stops streaming without a release event, for example when the button disconnects while held.
+  public func cancel(_ identifier: UUID) {
+    queue.async {
+      self.stop(identifier)
+    }
+  }
+
+  @discardableResult
+  private func stop(_ identifier: UUID) -> Hold? {
+    guard let hold = holds.removeValue(forKey: identifier) else { return nil }
+    hold.timer.cancel()
+    return hold
+  }
+}
+
+#if canImport(flic2lib)
+extension FlicHoldStreamer {
+  /// Call from `button:didReceiveButtonDown:age:`.
+  public func buttonDown(_ button: FLICButton, queued: Bool) {
+    buttonDown(button.identifier, queued: queued)
+  }
+
+  /// Call from `button:didReceiveButtonUp:age:`.
+  public func buttonUp(_ button: FLICButton, queued: Bool) {
+    buttonUp(button.identifier, queued: queued)
+  }
+
+  /// Call from `button:didDisconnectWithError:`, since the button up of a hold in progress will never arrive.
+  public func cancel(_ button: FLICButton) {
+    cancel(button.identifier)
+  }
+}
+#endif
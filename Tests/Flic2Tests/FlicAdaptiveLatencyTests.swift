@@ -0,0 +1,121 @@
+import XCTest
+import Flic2
+
+// Times are multiples of 1/8 s so that windows and fractions compare exactly.
+final class FlicAdaptiveLatencyTests: XCTestCase {
+  private let decay = FlicLatencyDecay(window: 1, growth: 2, maxWindow: 4)
+
+  func testPressesExtendTheWindowUpToTheMaximum() {
+    let policy = FlicLatencyPolicy(decay: decay)
+    XCTAssertEqual(policy.press(at: 0), .low)
+    XCTAssertEqual(policy.nextDeadline, 1)
+    XCTAssertNil(policy.press(at: 0.5))
+    XCTAssertEqual(policy.nextDeadline, 2.5)
+    XCTAssertNil(policy.press(at: 1))
+    XCTAssertEqual(policy.nextDeadline, 5)
+    XCTAssertNil(policy.press(at: 2))
+    XCTAssertEqual(policy.nextDeadline, 6)
+
+    XCTAssertNil(policy.advance(to: 5.5))
+    XCTAssertEqual(policy.advance(to: 6), .normal)
+    XCTAssertEqual(policy.level, .normal)
+    XCTAssertNil(policy.nextDeadline)
+  }
+
+  func testWindowStartsOverAfterRelaxing() {
+    let policy = FlicLatencyPolicy(decay: decay)
+    policy.press(at: 0)
+    policy.press(at: 0.5)
+
+    // The press arrives after the window expired, so it relaxes and tightens again.
+    XCTAssertNil(policy.press(at: 10))
+    XCTAssertEqual(policy.level, .low)
+    XCTAssertEqual(policy.nextDeadline, 11)
+  }
+
+  func testReset() {
+    let policy = FlicLatencyPolicy(decay: decay)
+    XCTAssertNil(policy.reset())
+    policy.press(at: 0)
+    XCTAssertEqual(policy.reset(), .normal)
+    XCTAssertNil(policy.nextDeadline)
+    XCTAssertEqual(policy.press(at: 0.5), .low)
+    XCTAssertEqual(policy.nextDeadline, 1.5)
+  }
+
+  // MARK: - Controller
+
+  func testControllerReportsChangesAndIgnoresQueuedPresses() {
+    var now: TimeInterval = 0
+    var changes: [FlicLatencyLevel] = []
+    let controller = FlicLatencyController(decay: decay, clock: { now }) { _, level in
+      changes.append(level)
+    }
+    let button = UUID()
+
+    controller.buttonDown(button, queued: true)
+    XCTAssertEqual(controller.level(for: button), .normal)
+    controller.buttonDown(button, queued: false)
+    now = 0.25
+    controller.buttonDown(button, queued: false)
+    XCTAssertEqual(changes, [.low])
+
+    controller.reset(button)
+    controller.buttonDown(button, queued: false)
+    controller.forget(button)
+    XCTAssertEqual(changes, [.low, .normal, .low, .normal])
+    XCTAssertEqual(controller.level(for: button), .normal)
+  }
+
+  func testControllerRelaxesWhenTheWindowExpires() {
+    let relaxed = expectation(description: "relaxed")
+    let controller = FlicLatencyController(decay: FlicLatencyDecay(window: 0.05)) { _, level in
+      if level == .normal {
+        relaxed.fulfill()
+      }
+    }
+    controller.buttonDown(UUID(), queued: false)
+    wait(for: [relaxed], timeout: 2)
+  }
+
+  // MARK: - Simulation
+
+  private let model = FlicLatencySimulation.Model(normalLatency: 0.5, lowLatency: 0.125, lowDutyCycle: 3, switchDelay: 0.5)
+
+  func testSimulationOfADoubleClickAndASingleClick() {
+    let simulation = FlicLatencySimulation(decay: decay, model: model)
+    let report = simulation.run(presses: [8, 0, 0.25, 1], duration: 16)
+
+    XCTAssertEqual(report.presses, 4)
+    // The second half of the double click arrives before low latency mode has taken effect. Only the press at 1 is fast.
+    XCTAssertEqual(report.lowLatencyPresses, 1)
+    XCTAssertEqual(report.meanLatency, 0.40625)
+    // Low from 0.5 to 5 and from 8.5 to 9.
+    XCTAssertEqual(report.lowFraction, 5 / 16)
+    XCTAssertEqual(report.relativeDutyCycle, 1 + 2 * 5 / 16)
+  }
+
+  func testSimulationWithoutSwitchDelayCountsTheSecondClickAsFast() {
+    var instant = model
+    instant.switchDelay = 0
+    let report = FlicLatencySimulation(decay: decay, model: instant).run(presses: [0, 0.25], duration: 16)
+    XCTAssertEqual(report.lowLatencyPresses, 1)
+    // Low from 0 to 2.25.
+    XCTAssertEqual(report.lowFraction, 2.25 / 16)
+  }
+
+  func testSimulationClipsTheLastWindowToTheTrace() {
+    let simulation = FlicLatencySimulation(decay: decay, model: model)
+    let report = simulation.run(presses: [15.25], duration: 16)
+    // Low from 15.75 until the trace ends at 16.
+    XCTAssertEqual(report.lowFraction, 0.25 / 16)
+    XCTAssertEqual(report.meanLatency, 0.5)
+  }
+
+  func testSimulationOfAnEmptyTrace() {
+    let report = FlicLatencySimulation(decay: decay, model: model).run(presses: [], duration: 60)
+    XCTAssertEqual(report.presses, 0)
+    XCTAssertEqual(report.meanLatency, 0.5)
+    XCTAssertEqual(report.relativeDutyCycle, 1)
+  }
+}
@@ -0,0 +1,135 @@
+import XCTest
+import Flic2
+
+final class FlicCallbackQueueTests: XCTestCase {
+  private var target: DispatchQueue!
+  private var suspended = false
+  private var delivered: [String] = []
+  private let lock = NSLock()
+
+  override func setUp() {
+    super.setUp()
+    // Suspended until `drain` so that the consumer is stalled while the producer fills the queue.
+    target = DispatchQueue(label: "flic2.tests.callbackqueue")
+    target.suspend()
+    suspended = true
+    delivered = []
+  }
+
+  override func tearDown() {
+    // Releasing a suspended queue crashes, so a test that failed before draining must not leave it suspended.
+    resume()
+    super.tearDown()
+  }
+
+  private func resume() {
+    if suspended {
+      suspended = false
+      target.resume()
+    }
+  }
+
+  private func makeQueue(capacity: Int, policy: FlicOverflowPolicy) -> FlicCallbackQueue<FlicButtonEvent> {
+    return FlicCallbackQueue(capacity: capacity, policy: policy, targetQueue: target) { [unowned self] event in
+      self.lock.lock()
+      self.delivered.append(FlicCallbackQueueTests.describe(event))
+      self.lock.unlock()
+    }
+  }
+
+  private func drain() -> [String] {
+    resume()
+    target.sync {}
+    lock.lock()
+    defer { lock.unlock() }
+    return delivered
+  }
+
+  private static func describe(_ event: FlicButtonEvent) -> String {
+    switch event {
+    case .click(_, let age): return "click\(age)"
+    case .batteryVoltage(let voltage): return "battery\(voltage)"
+    case .nickname(let nickname): return "nickname:\(nickname)"
+    default: return "\(event.kind)"
+    }
+  }
+
+  func testDropOldestKeepsTheNewestEvents() {
+    let queue = makeQueue(capacity: 3, policy: .dropOldest)
+    for age in 0..<5 {
+      queue.enqueue(.click(queued: true, age: age))
+    }
+
+    XCTAssertEqual(queue.depth, 3)
+    XCTAssertEqual(queue.maxDepth, 3)
+    XCTAssertEqual(queue.droppedCount, 2)
+    XCTAssertEqual(queue.coalescedCount, 0)
+    XCTAssertEqual(drain(), ["click2", "click3", "click4"])
+    XCTAssertEqual(queue.depth, 0)
+  }
+
+  func testCoalesceReplacesQueuedStateUpdatesInPlace() {
+    let queue = makeQueue(capacity: 4, policy: .coalesce)
+    queue.enqueue(.batteryVoltage(3.0))
+    queue.enqueue(.click(queued: false, age: 0))
+    queue.enqueue(.batteryVoltage(2.5))
+    queue.enqueue(.nickname("a"))
+    queue.enqueue(.nickname("b"))
+
+    XCTAssertEqual(queue.depth, 3)
+    XCTAssertEqual(queue.coalescedCount, 2)
+    XCTAssertEqual(queue.droppedCount, 0)
+    XCTAssertEqual(drain(), ["battery2.5", "click0", "nickname:b"])
+  }
+
+  func testCoalesceDropsOldestWhenFull() {
+    let queue = makeQueue(capacity: 2, policy: .coalesce)
+    queue.enqueue(.click(queued: false, age: 0))
+    queue.enqueue(.click(queued: false, age: 1))
+    queue.enqueue(.click(queued: false, age: 2))
+
+    XCTAssertEqual(queue.droppedCount, 1)
+    XCTAssertEqual(drain(), ["click1", "click2"])
+  }
+
+  func testPreservePressesNeverDropsPresses() {
+    let queue = makeQueue(capacity: 2, policy: .preservePresses)
+    queue.enqueue(.batteryVoltage(3.0))
+    queue.enqueue(.click(queued: false, age: 0))
+    queue.enqueue(.click(queued: false, age: 1))
+    XCTAssertEqual(queue.droppedCount, 1)
+    XCTAssertEqual(queue.depth, 2)
+
+    // Only presses are queued, so a state update is discarded and another press goes above capacity.
+    queue.enqueue(.nickname("a"))
+    XCTAssertEqual(queue.droppedCount, 2)
+    XCTAssertEqual(queue.depth, 2)
+    queue.enqueue(.click(queued: false, age: 2))
+    XCTAssertEqual(queue.droppedCount, 2)
+    XCTAssertEqual(queue.depth, 3)
+    XCTAssertEqual(queue.maxDepth, 3)
+
+    XCTAssertEqual(drain(), ["click0", "click1", "click2"])
+  }
+
+  func testBlockWaitsForTheConsumer() {
+    let queue = makeQueue(capacity: 1, policy: .block)
+    queue.enqueue(.click(queued: false, age: 0))
+
+    let enqueued = expectation(description: "second enqueue returned")
+    DispatchQueue.global().async {
+      queue.enqueue(.click(queued: false, age: 1))
+      enqueued.fulfill()
+    }
+    XCTAssertEqual(XCTWaiter.wait(for: [enqueued], timeout: 0.2), .timedOut)
+    XCTAssertEqual(queue.depth, 1)
+
+    resume()
+    wait(for: [enqueued], timeout: 2)
+    target.sync {}
+    lock.lock()
+    XCTAssertEqual(delivered, ["click0", "click1"])
+    lock.unlock()
+    XCTAssertEqual(queue.droppedCount, 0)
+  }
+}
@@ -0,0 +1,100 @@
+#if canImport(flic2lib)
+import XCTest
+import flic2lib
+import Flic2
+
+/// Per-event cost of `FlicDelegateDispatchTable` against the optional protocol call it replaces, which is a
+/// `respondsToSelector:` check followed by a normal message send. Events the delegate does not implement are measured
+/// through `FlicEventBus`, where they are dropped by the routing table.
+final class FlicDelegateDispatchTableTests: XCTestCase {
+  private let iterations = 1_000_000
+  private let delegate = ClickDelegate()
+  private let standIn = FlicButtonStandIn()
+  private lazy var button = standIn.button
+
+  func testMaskOnlyContainsImplementedMethods() {
+    let table = FlicDelegateDispatchTable(delegate: delegate)
+    let expected: FlicEventMask = [FlicEventMask(.didConnect), FlicEventMask(.isReady), FlicEventMask(.didDisconnect),
+                                   FlicEventMask(.didFailToConnect), FlicEventMask(.click)]
+    XCTAssertEqual(table.mask, expected)
+
+    table.dispatch(.click(queued: false, age: 0), from: button)
+    table.dispatch(.hold(queued: false, age: 0), from: button)
+    XCTAssertEqual(delegate.clicks, 1)
+  }
+
+  func testDispatchTableImplementedEvent() {
+    let table = FlicDelegateDispatchTable(delegate: delegate)
+    let event = FlicButtonEvent.click(queued: false, age: 0)
+    let button = self.button
+    measure {
+      for _ in 0..<iterations {
+        table.dispatch(event, from: button)
+      }
+    }
+  }
+
+  func testOptionalProtocolCallImplementedEvent() {
+    let delegate: FLICButtonDelegate = self.delegate
+    let button = self.button
+    measure {
+      for _ in 0..<iterations {
+        delegate.button?(button, didReceiveButtonClick: false, age: 0)
+      }
+    }
+  }
+
+  func testBusUnimplementedEvent() {
+    let bus = FlicEventBus()
+    let subscription = bus.subscribe(delegate: delegate)
+    let button = self.button
+    measure {
+      for _ in 0..<iterations {
+        bus.button(button, didReceiveButtonHold: false, age: 0)
+      }
+    }
+    subscription.cancel()
+  }
+
+  func testOptionalProtocolCallUnimplementedEvent() {
+    let delegate: FLICButtonDelegate = self.delegate
+    let button = self.button
+    measure {
+      for _ in 0..<iterations {
+        delegate.button?(button, didReceiveButtonHold: false, age: 0)
+      }
+    }
+  }
+
+  /// Attaches nanoseconds per event for all four cases side by side to the test result.
+  func testReportDispatchCost() {
+    let table = FlicDelegateDispatchTable(delegate: delegate)
+    let bus = FlicEventBus()
+    let subscription = bus.subscribe(delegate: delegate)
+    let delegate: FLICButtonDelegate = self.delegate
+    let button = self.button
+    let click = FlicButtonEvent.click(queued: false, age: 0)
+
+    let tableHit = nanosecondsPerEvent { table.dispatch(click, from: button) }
+    let messageHit = nanosecondsPerEvent { delegate.button?(button, didReceiveButtonClick: false, age: 0) }
+    let busMiss = nanosecondsPerEvent { bus.button(button, didReceiveButtonHold: false, age: 0) }
+    let messageMiss = nanosecondsPerEvent { delegate.button?(button, didReceiveButtonHold: false, age: 0) }
+    subscription.cancel()
+
+    let report = String(format: "dispatch ns/event  implemented: table %.1f, respondsToSelector+send %.1f  unimplemented: bus %.1f, respondsToSelector %.1f",
+                        tableHit, messageHit, busMiss, messageMiss)
+    let attachment = XCTAttachment(string: report)
+    attachment.name = "Dispatch cost"
+    attachment.lifetime = .keepAlways
+    add(attachment)
+  }
+
+  private func nanosecondsPerEvent(_ body: () -> Void) -> Double {
+    let start = DispatchTime.now().uptimeNanoseconds
+    for _ in 0..<iterations {
+      body()
+    }
+    return Double(DispatchTime.now().uptimeNanoseconds - start) / Double(iterations)
+  }
+}
+#endif
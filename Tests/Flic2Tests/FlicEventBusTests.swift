@@ -0,0 +1,103 @@
+#if canImport(flic2lib)
+import XCTest
+import flic2lib
+import Flic2
+
+final class FlicEventBusTests: XCTestCase {
+  private let target = DispatchQueue(label: "flic2.tests.eventbus")
+  private let first = FlicButtonStandIn()
+  private let second = FlicButtonStandIn()
+  private var events: [String: [String]] = [:]
+
+  /// Records events for `name` on the target queue.
+  private func record(_ name: String) -> (FlicBusEvent) -> Void {
+    return { [unowned self] busEvent in
+      self.events[name, default: []].append(self.describe(busEvent))
+    }
+  }
+
+  /// Waits for everything handed to the target queue so far, then returns what `name` received.
+  private func received(by name: String) -> [String] {
+    return target.sync { events[name] ?? [] }
+  }
+
+  private func describe(_ busEvent: FlicBusEvent) -> String {
+    let button = busEvent.button.identifier == first.identifier ? "first" : "second"
+    switch busEvent.event {
+    case .batteryVoltage(let voltage): return "\(button):battery\(voltage)"
+    default: return "\(button):\(busEvent.event.kind)"
+    }
+  }
+
+  func testMaskFiltersEvents() {
+    let bus = FlicEventBus()
+    let subscription = bus.subscribe(.presses, queue: target, handler: record("presses"))
+    bus.buttonDidConnect(first.button)
+    bus.button(first.button, didReceiveButtonClick: false, age: 0)
+    bus.button(first.button, didUpdateBatteryVoltage: 3)
+    bus.button(first.button, didReceiveButtonHold: false, age: 0)
+
+    XCTAssertEqual(received(by: "presses"), ["first:click", "first:hold"])
+    subscription.cancel()
+  }
+
+  func testButtonSubscribersOnlySeeTheirButton() {
+    let bus = FlicEventBus()
+    let all = bus.subscribe(queue: target, handler: record("all"))
+    let only = bus.subscribe(button: second.button, queue: target, handler: record("second"))
+    bus.button(first.button, didReceiveButtonClick: false, age: 0)
+    bus.button(second.button, didReceiveButtonClick: false, age: 0)
+
+    XCTAssertEqual(received(by: "all"), ["first:click", "second:click"])
+    XCTAssertEqual(received(by: "second"), ["second:click"])
+    all.cancel()
+    only.cancel()
+  }
+
+  func testNoHandlerCallAfterCancelEvenForBufferedEvents() {
+    let bus = FlicEventBus()
+    let subscription = bus.subscribe(queue: target, handler: record("cancelled"))
+    target.suspend()
+    bus.button(first.button, didReceiveButtonClick: false, age: 0)
+    bus.button(first.button, didReceiveButtonClick: false, age: 1)
+    subscription.cancel()
+    target.resume()
+    bus.button(first.button, didReceiveButtonClick: false, age: 2)
+
+    XCTAssertEqual(received(by: "cancelled"), [])
+  }
+
+  func testBatteryUpdatesCoalescePerButton() {
+    let bus = FlicEventBus()
+    let subscription = bus.subscribe(.state, queue: target, capacity: 8, policy: .coalesce, handler: record("state"))
+    target.suspend()
+    bus.button(first.button, didUpdateBatteryVoltage: 3)
+    bus.button(second.button, didUpdateBatteryVoltage: 3)
+    bus.button(first.button, didUpdateBatteryVoltage: 2.5)
+    bus.button(second.button, didUpdateBatteryVoltage: 2.75)
+    target.resume()
+
+    XCTAssertEqual(received(by: "state"), ["first:battery2.5", "second:battery2.75"])
+    subscription.cancel()
+  }
+
+  func testDelegateSubscriptionEndsWithItsDelegate() {
+    let bus = FlicEventBus()
+    var delegate: ClickDelegate? = ClickDelegate()
+    let subscription = bus.subscribe(delegate: delegate!, queue: target)
+    bus.button(first.button, didReceiveButtonClick: false, age: 0)
+    target.sync {}
+    XCTAssertEqual(delegate?.clicks, 1)
+
+    delegate = nil
+    bus.button(first.button, didReceiveButtonClick: false, age: 0)
+    target.sync {}
+    // The delegate was found gone on the target queue. The bus drops the subscription on the main queue.
+    let unsubscribed = expectation(description: "unsubscribed")
+    DispatchQueue.main.async { unsubscribed.fulfill() }
+    wait(for: [unsubscribed], timeout: 2)
+
+    XCTAssertTrue(subscription.isCancelled)
+  }
+}
+#endif
@@ -0,0 +1,179 @@
+import XCTest
+import Flic2
+
+final class FlicEventOutboxTests: XCTestCase {
+  private var directory: URL!
+  private var url: URL!
+  private let deliveryQueue = DispatchQueue(label: "flic2.tests.outbox")
+  private var delivered: [FlicOutboxEvent] = []
+
+  override func setUp() {
+    super.setUp()
+    directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+    url = directory.appendingPathComponent("outbox.log")
+    delivered = []
+  }
+
+  override func tearDown() {
+    try? FileManager.default.removeItem(at: directory)
+    super.tearDown()
+  }
+
+  private func openOutbox(commitDelay: TimeInterval = 0.005) throws -> FlicEventOutbox {
+    return try FlicEventOutbox(url: url, commitDelay: commitDelay, deliveryQueue: deliveryQueue) { [weak self] event in
+      self?.delivered.append(event)
+    }
+  }
+
+  /// Waits for everything handed to the delivery queue so far, then returns and clears what was delivered.
+  private func takeDelivered() -> [FlicOutboxEvent] {
+    return deliveryQueue.sync { () -> [FlicOutboxEvent] in
+      defer { delivered = [] }
+      return delivered
+    }
+  }
+
+  private func lines() throws -> [String] {
+    let contents = try String(contentsOf: url, encoding: .utf8)
+    return contents.split(separator: "\n").map(String.init)
+  }
+
+  private func append(_ outbox: FlicEventOutbox, count: Int, pressCount: UInt32 = 7) {
+    for _ in 0..<count {
+      outbox.append(kind: .click, button: "button", pressCount: pressCount, queued: false, age: 0)
+    }
+  }
+
+  func testEventsAreDeliveredOnceCommitted() throws {
+    let outbox = try openOutbox()
+    append(outbox, count: 2)
+    outbox.flush()
+
+    let events = takeDelivered()
+    XCTAssertEqual(events.map { $0.sequence }, [1, 2])
+    XCTAssertEqual(events.map { $0.kind }, [.click, .click])
+    XCTAssertEqual(try lines().count, 2)
+    XCTAssertEqual(outbox.unacknowledgedCount, 2)
+  }
+
+  func testGroupCommitWritesNothingUntilTheBatchIsCommitted() throws {
+    let outbox = try openOutbox(commitDelay: 60)
+    append(outbox, count: 3)
+
+    // Waits for the appends to reach the outbox.
+    XCTAssertEqual(outbox.unacknowledgedCount, 3)
+    XCTAssertEqual(try lines().count, 0)
+    XCTAssertEqual(takeDelivered().count, 0)
+
+    outbox.flush()
+    XCTAssertEqual(try lines().count, 3)
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [1, 2, 3])
+  }
+
+  func testUnacknowledgedEventsAreRedeliveredAfterReopening() throws {
+    var outbox: FlicEventOutbox? = try openOutbox()
+    append(outbox!, count: 3)
+    outbox?.flush()
+    outbox?.acknowledge(2)
+    outbox?.flush()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [1, 2, 3])
+    outbox = nil
+
+    outbox = try openOutbox()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [1, 3])
+
+    outbox?.redeliverUnacknowledged()
+    outbox?.flush()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [1, 3])
+  }
+
+  func testKeysStayUniqueAcrossReopening() throws {
+    var outbox: FlicEventOutbox? = try openOutbox()
+    append(outbox!, count: 2, pressCount: 5)
+    outbox?.flush()
+    outbox = nil
+
+    outbox = try openOutbox()
+    _ = takeDelivered()
+    append(outbox!, count: 1, pressCount: 5)
+    append(outbox!, count: 1, pressCount: 6)
+    append(outbox!, count: 1, pressCount: 3)
+    outbox?.flush()
+
+    let keys = takeDelivered().map { $0.key }
+    XCTAssertEqual(keys.map { $0.ordinal }, [2, 0, 0])
+    XCTAssertEqual(keys.map { $0.eventCount }, [5, 6, 3])
+    // The count going backwards is taken as a reboot.
+    XCTAssertEqual(keys.map { $0.bootID }, [0, 0, 1])
+  }
+
+  func testTornFinalLineIsDiscardedOnReopen() throws {
+    var outbox: FlicEventOutbox? = try openOutbox()
+    append(outbox!, count: 2)
+    outbox?.flush()
+    outbox = nil
+    _ = takeDelivered()
+
+    let handle = try FileHandle(forWritingTo: url)
+    handle.seekToEndOfFile()
+    handle.write(Data("{\"event\":{\"seq".utf8))
+    handle.closeFile()
+
+    outbox = try openOutbox()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [1, 2])
+    XCTAssertEqual(try lines().count, 2)
+
+    append(outbox!, count: 1)
+    outbox?.flush()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [3])
+    outbox = nil
+
+    // The event appended after the torn line must survive another reload.
+    outbox = try openOutbox()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, [1, 2, 3])
+  }
+
+  func testCompactionKeepsOnlyLiveState() throws {
+    var outbox: FlicEventOutbox? = try openOutbox(commitDelay: 60)
+    append(outbox!, count: 1100)
+    outbox?.flush()
+    let events = takeDelivered()
+    XCTAssertEqual(events.count, 1100)
+    XCTAssertEqual(try lines().count, 1100)
+
+    events.forEach { outbox?.acknowledge($0.sequence) }
+    outbox?.flush()
+    // The boot state of the one button and the sequence counter.
+    XCTAssertEqual(try lines().count, 2)
+    XCTAssertEqual(outbox?.unacknowledgedCount, 0)
+    outbox = nil
+
+    outbox = try openOutbox()
+    XCTAssertEqual(takeDelivered().count, 0)
+    append(outbox!, count: 1)
+    outbox?.flush()
+
+    let next = takeDelivered()
+    XCTAssertEqual(next.map { $0.sequence }, [1101])
+    XCTAssertEqual(next.first?.key.ordinal, 1100)
+    XCTAssertEqual(next.first?.key.bootID, 0)
+  }
+
+  func testCompactionRunsWhilePendingEventsRemain() throws {
+    var outbox: FlicEventOutbox? = try openOutbox(commitDelay: 60)
+    append(outbox!, count: 3300)
+    outbox?.flush()
+    let events = takeDelivered()
+    XCTAssertEqual(events.count, 3300)
+
+    events.prefix(3000).forEach { outbox?.acknowledge($0.sequence) }
+    outbox?.flush()
+    // The boot state, the 300 pending events and the sequence counter.
+    XCTAssertEqual(try lines().count, 302)
+    XCTAssertEqual(outbox?.unacknowledgedCount, 300)
+    outbox = nil
+
+    outbox = try openOutbox()
+    XCTAssertEqual(takeDelivered().map { $0.sequence }, Array(3001...3300))
+  }
+}
@@ -0,0 +1,162 @@
+import XCTest
+import Flic2
+
+// Times are multiples of 1/8 s so that deadlines compare exactly.
+final class FlicGestureRecognizerTests: XCTestCase {
+  private let thresholds = FlicGestureThresholds(multiClickWindow: 0.25, holdDuration: 0.5, maxClickCount: 3)
+
+  func testSingleClickIsDecidedWhenTheWindowExpires() {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    XCTAssertEqual(recognizer.buttonDown(at: 10.0), [])
+    XCTAssertEqual(recognizer.nextDeadline, 10.5)
+    XCTAssertEqual(recognizer.buttonUp(at: 10.125), [])
+    XCTAssertEqual(recognizer.nextDeadline, 10.375)
+    XCTAssertEqual(recognizer.advance(to: 10.25), [])
+
+    let decisions = recognizer.advance(to: 10.5)
+    XCTAssertEqual(decisions.map { $0.gesture }, [.click(count: 1)])
+    XCTAssertEqual(decisions.first?.startTime, 10.0)
+    XCTAssertEqual(decisions.first?.decisionTime, 10.375)
+    XCTAssertNil(recognizer.nextDeadline)
+  }
+
+  func testDoubleClickWaitsForTheWindow() {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    _ = recognizer.buttonDown(at: 0.0)
+    _ = recognizer.buttonUp(at: 0.125)
+    XCTAssertEqual(recognizer.buttonDown(at: 0.25), [])
+    XCTAssertEqual(recognizer.buttonUp(at: 0.375), [])
+
+    let decisions = recognizer.advance(to: 0.75)
+    XCTAssertEqual(decisions.map { $0.gesture }, [.click(count: 2)])
+    XCTAssertEqual(decisions.first?.decisionTime, 0.625)
+  }
+
+  func testReachingMaxClickCountDecidesOnButtonUp() {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    _ = recognizer.buttonDown(at: 0.0)
+    _ = recognizer.buttonUp(at: 0.125)
+    _ = recognizer.buttonDown(at: 0.25)
+    _ = recognizer.buttonUp(at: 0.375)
+    _ = recognizer.buttonDown(at: 0.5)
+
+    let decisions = recognizer.buttonUp(at: 0.625)
+    XCTAssertEqual(decisions.map { $0.gesture }, [.click(count: 3)])
+    XCTAssertEqual(decisions.first?.decisionTime, 0.625)
+    XCTAssertNil(recognizer.nextDeadline)
+  }
+
+  func testHoldIsDecidedWhileTheButtonIsStillDown() {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    _ = recognizer.buttonDown(at: 1.0)
+
+    let decisions = recognizer.advance(to: 1.5)
+    XCTAssertEqual(decisions.map { $0.gesture }, [.hold])
+    XCTAssertEqual(decisions.first?.decisionTime, 1.5)
+    XCTAssertNil(recognizer.nextDeadline)
+    XCTAssertEqual(recognizer.buttonUp(at: 2.5), [])
+    XCTAssertEqual(recognizer.advance(to: 10), [])
+  }
+
+  func testClickThenHold() {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    _ = recognizer.buttonDown(at: 0.0)
+    _ = recognizer.buttonUp(at: 0.125)
+    _ = recognizer.buttonDown(at: 0.25)
+
+    let decisions = recognizer.advance(to: 0.75)
+    XCTAssertEqual(decisions.map { $0.gesture }, [.clickThenHold(clicks: 1)])
+    XCTAssertEqual(decisions.first?.startTime, 0.0)
+  }
+
+  func testLateButtonDownStartsANewGesture() {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    _ = recognizer.buttonDown(at: 0.0)
+    _ = recognizer.buttonUp(at: 0.125)
+
+    let first = recognizer.buttonDown(at: 0.5)
+    XCTAssertEqual(first.map { $0.gesture }, [.click(count: 1)])
+    XCTAssertEqual(first.first?.decisionTime, 0.375)
+    XCTAssertEqual(recognizer.nextDeadline, 1.0)
+    _ = recognizer.buttonUp(at: 0.625)
+
+    let second = recognizer.advance(to: 1.0)
+    XCTAssertEqual(second.map { $0.gesture }, [.click(count: 1)])
+    XCTAssertEqual(second.first?.startTime, 0.5)
+    XCTAssertNotEqual(second.first?.id, first.first?.id)
+  }
+
+  // MARK: - Speculative mode
+
+  private func speculativeRecognizer() -> FlicGestureRecognizer {
+    let recognizer = FlicGestureRecognizer(thresholds: thresholds)
+    recognizer.speculative = true
+    return recognizer
+  }
+
+  func testProvisionalClickIsConfirmedWithTheSameID() {
+    let recognizer = speculativeRecognizer()
+    _ = recognizer.buttonDown(at: 0.0)
+
+    let provisional = recognizer.buttonUp(at: 0.125)
+    XCTAssertEqual(provisional.map { $0.gesture }, [.provisionalClick])
+    XCTAssertEqual(provisional.first?.decisionTime, 0.125)
+
+    let confirmation = recognizer.advance(to: 0.5)
+    XCTAssertEqual(confirmation.map { $0.gesture }, [.click(count: 1)])
+    XCTAssertEqual(confirmation.first?.id, provisional.first?.id)
+  }
+
+  func testProvisionalClickIsRetractedBeforeTheDoubleClick() {
+    let recognizer = speculativeRecognizer()
+    _ = recognizer.buttonDown(at: 0.0)
+    let provisional = recognizer.buttonUp(at: 0.125)
+
+    let retraction = recognizer.buttonDown(at: 0.25)
+    XCTAssertEqual(retraction.map { $0.gesture }, [.retraction])
+    XCTAssertEqual(retraction.first?.id, provisional.first?.id)
+    XCTAssertEqual(retraction.first?.decisionTime, 0.25)
+
+    XCTAssertEqual(recognizer.buttonUp(at: 0.375), [])
+    let doubleClick = recognizer.advance(to: 0.75)
+    XCTAssertEqual(doubleClick.map { $0.gesture }, [.click(count: 2)])
+    XCTAssertEqual(doubleClick.first?.id, provisional.first?.id)
+  }
+
+  func testProvisionalClickIsRetractedBeforeClickThenHold() {
+    let recognizer = speculativeRecognizer()
+    _ = recognizer.buttonDown(at: 0.0)
+    _ = recognizer.buttonUp(at: 0.125)
+
+    XCTAssertEqual(recognizer.buttonDown(at: 0.25).map { $0.gesture }, [.retraction])
+    XCTAssertEqual(recognizer.advance(to: 0.75).map { $0.gesture }, [.clickThenHold(clicks: 1)])
+  }
+
+  func testResetRetractsAPendingProvisionalClick() {
+    let recognizer = speculativeRecognizer()
+    _ = recognizer.buttonDown(at: 0.0)
+    let provisional = recognizer.buttonUp(at: 0.125)
+
+    let retraction = recognizer.reset(at: 0.25)
+    XCTAssertEqual(retraction.map { $0.gesture }, [.retraction])
+    XCTAssertEqual(retraction.first?.id, provisional.first?.id)
+    XCTAssertNil(recognizer.nextDeadline)
+    XCTAssertEqual(recognizer.advance(to: 1.0), [])
+  }
+
+  func testResetAfterTheWindowConfirmsInsteadOfRetracting() {
+    let recognizer = speculativeRecognizer()
+    _ = recognizer.buttonDown(at: 0.0)
+    _ = recognizer.buttonUp(at: 0.125)
+
+    XCTAssertEqual(recognizer.reset(at: 0.5).map { $0.gesture }, [.click(count: 1)])
+  }
+
+  func testNoProvisionalClickWhenASingleClickIsFinal() {
+    let recognizer = FlicGestureRecognizer(thresholds: FlicGestureThresholds(maxClickCount: 1))
+    recognizer.speculative = true
+    _ = recognizer.buttonDown(at: 0.0)
+
+    XCTAssertEqual(recognizer.buttonUp(at: 0.125).map { $0.gesture }, [.click(count: 1)])
+  }
+}
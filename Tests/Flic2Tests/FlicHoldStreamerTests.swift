@@ -0,0 +1,124 @@
+import XCTest
+import Flic2
+
+final class FlicHoldStreamerTests: XCTestCase {
+  private let queue = DispatchQueue(label: "flic2.tests.holdstreamer")
+  private let button = UUID()
+  private var events: [FlicHoldStreamEvent] = []
+  private var tickCount = 0
+  private var ticked: XCTestExpectation?
+  private var ticksToWaitFor = 0
+
+  private func makeStreamer(rate: Double = 20, startDelay: TimeInterval = 0, maxDuration: TimeInterval = 30) -> FlicHoldStreamer {
+    return FlicHoldStreamer(rate: rate, startDelay: startDelay, maxDuration: maxDuration, queue: queue) { [unowned self] _, event in
+      self.events.append(event)
+      if case .tick = event {
+        self.tickCount += 1
+        if self.tickCount == self.ticksToWaitFor {
+          self.ticked?.fulfill()
+        }
+      }
+    }
+  }
+
+  private func waitForTicks(_ count: Int) {
+    let ticked = expectation(description: "\(count) ticks")
+    queue.sync {
+      if tickCount >= count {
+        ticked.fulfill()
+      } else {
+        ticksToWaitFor = count
+        self.ticked = ticked
+      }
+    }
+    wait(for: [ticked], timeout: 2)
+  }
+
+  private static func ticks(in events: [FlicHoldStreamEvent]) -> [TimeInterval] {
+    return events.compactMap { event -> TimeInterval? in
+      if case .tick(let elapsed) = event {
+        return elapsed
+      }
+      return nil
+    }
+  }
+
+  private static func isRelease(_ event: FlicHoldStreamEvent) -> Bool {
+    if case .released = event {
+      return true
+    }
+    return false
+  }
+
+  /// Waits for everything handed to the streamer's queue so far, then returns what was emitted.
+  private func emitted() -> [FlicHoldStreamEvent] {
+    return queue.sync { events }
+  }
+
+  func testTicksAtTheConfiguredRate() {
+    let streamer = makeStreamer(rate: 20)
+    streamer.buttonDown(button, queued: false)
+    waitForTicks(3)
+    streamer.buttonUp(button, queued: false)
+
+    let events = emitted()
+    let elapsed = FlicHoldStreamerTests.ticks(in: events)
+    XCTAssertGreaterThanOrEqual(elapsed.count, 3)
+    // Strict timers never fire early, so tick n comes at least n intervals after the button down. The millisecond allows
+    // for the two clocks being read at slightly different moments.
+    for (index, value) in elapsed.enumerated() {
+      XCTAssertGreaterThanOrEqual(value, Double(index + 1) * 0.05 - 0.001)
+    }
+    XCTAssertEqual(elapsed, elapsed.sorted())
+    guard case .released(let duration)? = events.last else {
+      return XCTFail("expected a release, got \(events)")
+    }
+    XCTAssertGreaterThanOrEqual(duration, elapsed.last ?? 0)
+  }
+
+  func testClickReleasedBeforeStartDelayProducesNoEvents() {
+    let streamer = makeStreamer(startDelay: 10)
+    streamer.buttonDown(button, queued: false)
+    streamer.buttonUp(button, queued: false)
+
+    XCTAssertEqual(emitted(), [])
+  }
+
+  func testQueuedEventsAreIgnored() {
+    let streamer = makeStreamer(rate: 50)
+    streamer.buttonDown(button, queued: true)
+    Thread.sleep(forTimeInterval: 0.1)
+    streamer.buttonUp(button, queued: true)
+
+    XCTAssertEqual(emitted(), [])
+  }
+
+  func testCancelStopsTicksWithoutARelease() {
+    let streamer = makeStreamer(rate: 50)
+    streamer.buttonDown(button, queued: false)
+    waitForTicks(1)
+    streamer.cancel(button)
+    let count = emitted().count
+
+    Thread.sleep(forTimeInterval: 0.1)
+    streamer.buttonUp(button, queued: false)
+    let events = emitted()
+    XCTAssertEqual(events.count, count)
+    XCTAssertFalse(events.contains(where: FlicHoldStreamerTests.isRelease))
+  }
+
+  func testHoldStopsAfterMaxDuration() {
+    let streamer = makeStreamer(rate: 50, maxDuration: 0.1)
+    streamer.buttonDown(button, queued: false)
+    Thread.sleep(forTimeInterval: 0.3)
+    let count = emitted().count
+    XCTAssertGreaterThan(count, 0)
+
+    Thread.sleep(forTimeInterval: 0.1)
+    streamer.buttonUp(button, queued: false)
+    let events = emitted()
+    XCTAssertEqual(events.count, count)
+    XCTAssertFalse(events.contains(where: FlicHoldStreamerTests.isRelease))
+    XCTAssertEqual(FlicHoldStreamerTests.ticks(in: events).filter { $0 > 0.1 }, [])
+  }
+}
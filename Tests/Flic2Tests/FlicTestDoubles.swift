@@ -0,0 +1,28 @@
+#if canImport(flic2lib)
+import Foundation
+import flic2lib
+
+/// flic2lib has no public initializer for FLICButton. The code under test only asks a button for its `identifier`, so an
+/// object that answers that message can stand in for one.
+final class FlicButtonStandIn: NSObject {
+  @objc let identifier = UUID()
+
+  var button: FLICButton {
+    return unsafeBitCast(self, to: FLICButton.self)
+  }
+}
+
+/// A delegate that implements the required methods and counts clicks. Every other optional method is left out.
+final class ClickDelegate: NSObject, FLICButtonDelegate {
+  var clicks = 0
+
+  func buttonDidConnect(_ button: FLICButton) {}
+  func buttonIsReady(_ button: FLICButton) {}
+  func button(_ button: FLICButton, didDisconnectWithError error: Error?) {}
+  func button(_ button: FLICButton, didFailToConnectWithError error: Error?) {}
+
+  func button(_ button: FLICButton, didReceiveButtonClick queued: Bool, age: Int) {
+    clicks += 1
+  }
+}
+#endif